@@ -0,0 +1,203 @@
+#include "alloc_tracker.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+struct alloc_counters
+{
+	std::atomic<uint64_t> allocations = 0;
+	std::atomic<uint64_t> frees       = 0;
+	std::atomic<uint64_t> bytes       = 0;
+};
+
+static alloc_counters counters[ALLOC_PHASE_COUNT];
+
+static thread_local alloc_phase current_phase = ALLOC_OTHER;
+
+const char *alloc_phase_name(alloc_phase phase)
+{
+	switch (phase)
+	{
+		case ALLOC_OTHER:
+			return "other";
+		case ALLOC_EVENTS:
+			return "events";
+		case ALLOC_SIM:
+			return "simulation";
+		case ALLOC_UI:
+			return "ui";
+		case ALLOC_RENDER:
+			return "render";
+		default:
+			return "invalid";
+	}
+}
+
+alloc_counts alloc_totals(alloc_phase phase)
+{
+	const auto &c = counters[phase];
+	return {
+	  .allocations = c.allocations.load(std::memory_order_relaxed),
+	  .frees       = c.frees.load(std::memory_order_relaxed),
+	  .bytes       = c.bytes.load(std::memory_order_relaxed),
+	};
+}
+
+alloc_phase_scope::alloc_phase_scope(alloc_phase phase)
+: _previous(current_phase)
+{
+	current_phase = phase;
+}
+
+alloc_phase_scope::~alloc_phase_scope() { current_phase = _previous; }
+
+static void count_alloc(size_t size)
+{
+	auto &c = counters[current_phase];
+	c.allocations.fetch_add(1U, std::memory_order_relaxed);
+	c.bytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+static void count_free(void *ptr)
+{
+	if (!ptr) return;
+	counters[current_phase].frees.fetch_add(1U, std::memory_order_relaxed);
+}
+
+static void *tracked_alloc(size_t size)
+{
+	count_alloc(size);
+	return std::malloc(size ? size : 1U);
+}
+
+static void *tracked_aligned_alloc(size_t size, std::align_val_t align)
+{
+	count_alloc(size);
+	const size_t alignment = static_cast<size_t>(align);
+#ifdef _MSC_VER
+	return _aligned_malloc(size ? size : 1U, alignment);
+#else
+	// aligned_alloc requires the size to be a multiple of the alignment.
+	const size_t padded =
+	  ((size ? size : 1U) + alignment - 1U) & ~(alignment - 1U);
+	return std::aligned_alloc(alignment, padded);
+#endif
+}
+
+static void tracked_free(void *ptr)
+{
+	count_free(ptr);
+	std::free(ptr);
+}
+
+static void tracked_aligned_free(void *ptr)
+{
+	count_free(ptr);
+#ifdef _MSC_VER
+	_aligned_free(ptr);
+#else
+	std::free(ptr);
+#endif
+}
+
+void *alloc_tracked_malloc(size_t size) { return tracked_alloc(size); }
+
+void alloc_tracked_free(void *ptr) { tracked_free(ptr); }
+
+void *operator new(size_t size)
+{
+	if (void *result = tracked_alloc(size)) return result;
+	throw std::bad_alloc();
+}
+
+void *operator new[](size_t size)
+{
+	if (void *result = tracked_alloc(size)) return result;
+	throw std::bad_alloc();
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+	return tracked_alloc(size);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept
+{
+	return tracked_alloc(size);
+}
+
+void *operator new(size_t size, std::align_val_t align)
+{
+	if (void *result = tracked_aligned_alloc(size, align)) return result;
+	throw std::bad_alloc();
+}
+
+void *operator new[](size_t size, std::align_val_t align)
+{
+	if (void *result = tracked_aligned_alloc(size, align)) return result;
+	throw std::bad_alloc();
+}
+
+void *operator new(size_t size,
+                   std::align_val_t align,
+                   const std::nothrow_t &) noexcept
+{
+	return tracked_aligned_alloc(size, align);
+}
+
+void *operator new[](size_t size,
+                     std::align_val_t align,
+                     const std::nothrow_t &) noexcept
+{
+	return tracked_aligned_alloc(size, align);
+}
+
+void operator delete(void *ptr) noexcept { tracked_free(ptr); }
+void operator delete[](void *ptr) noexcept { tracked_free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { tracked_free(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { tracked_free(ptr); }
+
+void operator delete(void *ptr, const std::nothrow_t &) noexcept
+{
+	tracked_free(ptr);
+}
+
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept
+{
+	tracked_free(ptr);
+}
+
+void operator delete(void *ptr, std::align_val_t) noexcept
+{
+	tracked_aligned_free(ptr);
+}
+
+void operator delete[](void *ptr, std::align_val_t) noexcept
+{
+	tracked_aligned_free(ptr);
+}
+
+void operator delete(void *ptr, size_t, std::align_val_t) noexcept
+{
+	tracked_aligned_free(ptr);
+}
+
+void operator delete[](void *ptr, size_t, std::align_val_t) noexcept
+{
+	tracked_aligned_free(ptr);
+}
+
+void operator delete(void *ptr,
+                     std::align_val_t,
+                     const std::nothrow_t &) noexcept
+{
+	tracked_aligned_free(ptr);
+}
+
+void operator delete[](void *ptr,
+                       std::align_val_t,
+                       const std::nothrow_t &) noexcept
+{
+	tracked_aligned_free(ptr);
+}
@@ -0,0 +1,58 @@
+#ifndef ALLOC_TRACKER_HPP
+#define ALLOC_TRACKER_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+// Every global operator new/delete is counted against the phase of the
+// thread that called it.
+enum alloc_phase : uint8_t
+{
+	ALLOC_OTHER,
+	ALLOC_EVENTS,
+	ALLOC_SIM,
+	ALLOC_UI,
+	ALLOC_RENDER,
+	ALLOC_PHASE_COUNT
+};
+
+const char *alloc_phase_name(alloc_phase phase);
+
+struct alloc_counts
+{
+	uint64_t allocations = 0;
+	uint64_t frees       = 0;
+	uint64_t bytes       = 0;
+
+	alloc_counts operator-(const alloc_counts &rhs) const
+	{
+		return {
+		  .allocations = allocations - rhs.allocations,
+		  .frees       = frees - rhs.frees,
+		  .bytes       = bytes - rhs.bytes,
+		};
+	}
+};
+
+// malloc/free counted the same way as operator new/delete, for libraries
+// that take their own allocator hooks (ImGui).
+void *alloc_tracked_malloc(size_t size);
+void alloc_tracked_free(void *ptr);
+
+// Running totals since program start.
+alloc_counts alloc_totals(alloc_phase phase);
+
+// Attributes allocations on the current thread to `phase` until destroyed.
+struct alloc_phase_scope
+{
+	alloc_phase_scope(alloc_phase phase);
+	~alloc_phase_scope();
+
+	alloc_phase_scope(const alloc_phase_scope &)            = delete;
+	alloc_phase_scope &operator=(const alloc_phase_scope &) = delete;
+
+private:
+	alloc_phase _previous;
+};
+
+#endif
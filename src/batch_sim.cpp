@@ -0,0 +1,168 @@
+#include "batch_sim.hpp"
+
+#include "parallel.hpp"
+#include "space.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// Sessions per thread when stepping large batches, below this the
+// synchronisation cost outweighs the work.
+static constexpr size_t batch_min_sessions_per_thread = 16384U;
+
+batch_simulation::batch_simulation(const tile_grid &map, size_t sessions)
+: _map_width(map.width),
+  _map_height(map.height),
+  _pool(parallel_range_count(sessions, batch_min_sessions_per_thread))
+{
+	turn.resize(sessions);
+	roll.resize(sessions);
+	position_x.resize(sessions);
+	position_y.resize(sessions);
+	heading.resize(sessions);
+	speed.resize(sessions);
+	score.resize(sessions);
+	state.resize(sessions);
+	std::fill(turn.begin(), turn.end(), 0.0f);
+	std::fill(roll.begin(), roll.end(), 0.0f);
+
+	_blocks_stride = map.width + 2U;
+	_blocks.resize(_blocks_stride * (map.height + 2U));
+	std::fill(_blocks.begin(), _blocks.end(), uint8_t(0U));
+	for (size_t y = 0; y < map.height; ++y)
+		for (size_t x = 0; x < map.width; ++x)
+			_blocks[(x + 1U) + ((y + 1U) * _blocks_stride)] =
+			  map.has(x, y, TILE_BLOCK) ? 1U : 0U;
+
+	for (size_t y = 0; y < map.height; ++y)
+	{
+		for (size_t x = 0; x < map.width; ++x)
+		{
+			if (!map.has(x, y, TILE_COIN)) continue;
+			const auto pos = tile_position(x, y);
+			_coins_x.push_back(pos.x);
+			_coins_y.push_back(pos.y);
+		}
+	}
+
+	_collected.resize(_coins_x.size() * sessions);
+
+	for (size_t i = 0; i < sessions; ++i) reset(i);
+}
+
+inline bool batch_simulation::on_track(float x, float y) const
+{
+	// a block at tile (tx, ty) supports the player while the player is within
+	// 1 unit of its centre on both axes, so at most a 2x2 group of tiles can
+	// support any given position. Tiles outside the map are clamped into the
+	// empty border of _blocks, so every position does the same four lookups.
+	const float tx_min = std::ceil((x - 1.0f) * 0.5f);
+	const float tx_max = std::floor((x + 1.0f) * 0.5f);
+	const float ty_min = std::ceil((-y - 1.0f) * 0.5f);
+	const float ty_max = std::floor((-y + 1.0f) * 0.5f);
+
+	// +1 for the border, then clamp to [0, size + 1].
+	const float width  = float(_map_width + 1U);
+	const float height = float(_map_height + 1U);
+	const size_t x0    = size_t(std::clamp(tx_min + 1.0f, 0.0f, width));
+	const size_t x1    = size_t(std::clamp(tx_min + 2.0f, 0.0f, width));
+	const size_t y0    = size_t(std::clamp(ty_min + 1.0f, 0.0f, height));
+	const size_t y1    = size_t(std::clamp(ty_min + 2.0f, 0.0f, height));
+
+	// the second column/row only counts if it's in range.
+	const uint8_t x_pair = tx_max > tx_min ? 1U : 0U;
+	const uint8_t y_pair = ty_max > ty_min ? 1U : 0U;
+
+	const uint8_t *row0 = _blocks.data() + (y0 * _blocks_stride);
+	const uint8_t *row1 = _blocks.data() + (y1 * _blocks_stride);
+	return (row0[x0] | (row0[x1] & x_pair) | (row1[x0] & y_pair) |
+	        (row1[x1] & x_pair & y_pair)) != 0U;
+}
+
+void batch_simulation::step(float delta)
+{
+	_pool.run(sessions(),
+	          [&](size_t, size_t begin, size_t end)
+	          { step_range(begin, end, delta); });
+}
+
+void batch_simulation::step_range(size_t begin, size_t end, float delta)
+{
+	float *__restrict px         = position_x.data();
+	float *__restrict py         = position_y.data();
+	float *__restrict h          = heading.data();
+	float *__restrict v          = speed.data();
+	const float *__restrict tr   = turn.data();
+	const float *__restrict ro   = roll.data();
+	session_state *__restrict st = state.data();
+
+	// integration, same order as basic_window_loop: the player velocity comes
+	// from last frame's heading and ball speed, then the player frame updates,
+	// then the ball frame updates.
+	for (size_t i = begin; i < end; ++i)
+	{
+		const float dt = st[i] == SESSION_RUNNING ? delta : 0.0f;
+		const float vx = std::sin(h[i]) * v[i];
+		const float vy = -std::cos(h[i]) * v[i];
+		h[i]           = wrap_angle(h[i] + (tr[i] * 2.0f * dt));
+		px[i] += vx * dt;
+		py[i] += vy * dt;
+		v[i] += ro[i] * 3.0f * dt;
+	}
+
+	// coin collection, coin major so the inner loop runs over contiguous
+	// sessions.
+	uint32_t *__restrict sc = score.data();
+	for (size_t c = 0; c < coin_count(); ++c)
+	{
+		const float cx            = _coins_x[c];
+		const float cy            = _coins_y[c];
+		uint8_t *__restrict taken = _collected.data() + (c * sessions());
+		for (size_t i = begin; i < end; ++i)
+		{
+			const float dx    = cx - px[i];
+			const float dy    = cy - py[i];
+			const uint8_t hit = static_cast<uint8_t>(
+			  ((dx * dx) + (dy * dy) < 1.0f) & (taken[i] == 0U) &
+			  (st[i] == SESSION_RUNNING));
+			taken[i] |= hit;
+			sc[i] += hit;
+		}
+	}
+
+	// falling off takes priority over collecting the last coin.
+	const uint32_t coins = uint32_t(coin_count());
+	for (size_t i = begin; i < end; ++i)
+	{
+		const bool running = st[i] == SESSION_RUNNING;
+		const bool won     = sc[i] == coins;
+		const bool lost    = !on_track(px[i], py[i]);
+		const session_state next =
+		  lost ? SESSION_LOSS : (won ? SESSION_WIN : SESSION_RUNNING);
+		st[i] = running ? next : st[i];
+	}
+}
+
+void batch_simulation::reset(size_t session)
+{
+	position_x[session] = 0.0f;
+	position_y[session] = 0.0f;
+	heading[session]    = 0.0f;
+	speed[session]      = 0.0f;
+	score[session]      = 0U;
+	state[session]      = SESSION_RUNNING;
+	for (size_t c = 0; c < coin_count(); ++c)
+		_collected[(c * sessions()) + session] = 0U;
+}
+
+size_t batch_simulation::reset_finished()
+{
+	size_t result = 0;
+	for (size_t i = 0; i < sessions(); ++i)
+	{
+		if (state[i] == SESSION_RUNNING) continue;
+		reset(i);
+		++result;
+	}
+	return result;
+}
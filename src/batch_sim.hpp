@@ -0,0 +1,76 @@
+#ifndef BATCH_SIM_HPP
+#define BATCH_SIM_HPP
+
+#include "parallel.hpp"
+#include "tile_grid.hpp"
+
+#include <lak/array.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+enum session_state : uint8_t
+{
+	SESSION_RUNNING,
+	SESSION_WIN,
+	SESSION_LOSS
+};
+
+// Steps many independent sessions of the same map without a window. This
+// mirrors the RUNNING state of the game loop, but all per-session state is
+// stored as structure-of-arrays so every step runs the same arithmetic over
+// contiguous arrays of sessions.
+struct batch_simulation
+{
+	// inputs, one entry per session. written by the caller before each step.
+	// turn: +1 turns left, -1 turns right (left/right arrow keys).
+	// roll: +1 rolls forward, -1 rolls backward (up/down arrow keys).
+	lak::array<float> turn;
+	lak::array<float> roll;
+
+	// observations, one entry per session. updated by each step.
+	lak::array<float> position_x;
+	lak::array<float> position_y;
+	lak::array<float> heading;
+	lak::array<float> speed;
+	lak::array<uint32_t> score;
+	lak::array<session_state> state;
+
+	batch_simulation(const tile_grid &map, size_t sessions);
+
+	size_t sessions() const { return state.size(); }
+	size_t coin_count() const { return _coins_x.size(); }
+
+	// Advances every running session by `delta` seconds.
+	void step(float delta);
+
+	// Restarts a single session from the start of the map.
+	void reset(size_t session);
+
+	// Restarts every session that has won or lost, returns the number of
+	// sessions that were restarted.
+	size_t reset_finished();
+
+private:
+	void step_range(size_t begin, size_t end, float delta);
+
+	bool on_track(float x, float y) const;
+
+	size_t _map_width  = 0;
+	size_t _map_height = 0;
+	// TILE_BLOCK of each tile, with a border of empty tiles on every side so
+	// on_track can clamp out of bounds tiles into it instead of branching.
+	lak::array<uint8_t> _blocks;
+	size_t _blocks_stride = 0;
+
+	lak::array<float> _coins_x;
+	lak::array<float> _coins_y;
+
+	// coin major: _collected[(coin * sessions()) + session]
+	lak::array<uint8_t> _collected;
+
+	// reused by every step, rather than starting threads each step.
+	parallel_pool _pool;
+};
+
+#endif
@@ -0,0 +1,55 @@
+#include "input.hpp"
+
+#include <algorithm>
+
+bool input_queue::push(const input_event &event)
+{
+	if (_size == capacity) return false;
+	_events[(_head + _size) % capacity] = event;
+	++_size;
+	return true;
+}
+
+void latency_histogram::record(double seconds)
+{
+	const size_t bucket =
+	  std::min(static_cast<size_t>(seconds / bucket_seconds), bucket_count);
+	++buckets[bucket];
+	++samples;
+	total_seconds += seconds;
+	max_seconds = std::max(max_seconds, seconds);
+}
+
+double latency_histogram::percentile(double fraction) const
+{
+	if (samples == 0) return 0.0;
+	const uint64_t target = static_cast<uint64_t>(fraction * samples);
+	uint64_t seen         = 0;
+	for (size_t i = 0; i < bucket_count; ++i)
+	{
+		seen += buckets[i];
+		if (seen > target) return (i + 1) * bucket_seconds;
+	}
+	return max_seconds;
+}
+
+void present_latency_tracker::add(uint64_t timestamp, uint32_t frames)
+{
+	if (_size == capacity) return;
+	_pending[_size++] = {.timestamp = timestamp, .frames = frames};
+}
+
+void present_latency_tracker::frame_presented(uint64_t now,
+                                              uint64_t frequency,
+                                              latency_histogram &histogram)
+{
+	size_t kept = 0;
+	for (size_t i = 0; i < _size; ++i)
+	{
+		if (--_pending[i].frames == 0)
+			histogram.record(double(now - _pending[i].timestamp) / frequency);
+		else
+			_pending[kept++] = _pending[i];
+	}
+	_size = kept;
+}
@@ -0,0 +1,118 @@
+#ifndef INPUT_HPP
+#define INPUT_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+struct player_input
+{
+	// +1 turns left, -1 turns right.
+	float turn = 0.0f;
+	// +1 rolls forward, -1 rolls backward.
+	float roll = 0.0f;
+};
+
+enum input_axis : uint8_t
+{
+	INPUT_TURN,
+	INPUT_ROLL
+};
+
+struct input_event
+{
+	// performance counter value when lak dispatched the event. lak doesn't
+	// expose the OS event timestamp, so any time spent in the OS queue before
+	// dispatch (e.g. while the frame cap sleeps) isn't included.
+	uint64_t timestamp;
+	input_axis axis;
+	float value;
+};
+
+// Fixed capacity FIFO of input events, events are queued as they arrive and
+// applied to the player_input at the next tick boundary.
+struct input_queue
+{
+	static constexpr size_t capacity = 256;
+
+	// Returns false and drops the event if the queue is full.
+	bool push(const input_event &event);
+
+	// Applies every event received at or before `tick_time` to `input` in
+	// order, calling `on_applied(event)` for each one.
+	template<typename FUNC>
+	void apply(uint64_t tick_time, player_input &input, FUNC &&on_applied)
+	{
+		while (_size > 0 && _events[_head].timestamp <= tick_time)
+		{
+			const input_event &event = _events[_head];
+			switch (event.axis)
+			{
+				case INPUT_TURN:
+					input.turn = event.value;
+					break;
+				case INPUT_ROLL:
+					input.roll = event.value;
+					break;
+			}
+			on_applied(event);
+			_head = (_head + 1) % capacity;
+			--_size;
+		}
+	}
+
+private:
+	input_event _events[capacity];
+	size_t _head = 0;
+	size_t _size = 0;
+};
+
+struct latency_histogram
+{
+	static constexpr size_t bucket_count   = 64;
+	static constexpr double bucket_seconds = 0.0005;
+	static constexpr double range_seconds  = bucket_count * bucket_seconds;
+
+	// the last bucket counts everything over range_seconds.
+	uint32_t buckets[bucket_count + 1] = {};
+	uint64_t samples                   = 0;
+	double total_seconds               = 0.0;
+	double max_seconds                 = 0.0;
+
+	void record(double seconds);
+
+	double mean() const { return samples ? total_seconds / samples : 0.0; }
+
+	// Upper edge of the bucket containing the `fraction` quantile.
+	double percentile(double fraction) const;
+
+	void reset() { *this = {}; }
+};
+
+// Tracks applied input events until the frame that shows their effect has
+// been presented.
+struct present_latency_tracker
+{
+	static constexpr size_t capacity = 64;
+
+	// `frames` is how many presents until the effect of the event is on
+	// screen. Events are dropped from tracking if more than `capacity` are
+	// pending.
+	void add(uint64_t timestamp, uint32_t frames);
+
+	// Call once per frame after the previous frame has been presented.
+	void frame_presented(uint64_t now,
+	                     uint64_t frequency,
+	                     latency_histogram &histogram);
+
+private:
+	struct pending
+	{
+		uint64_t timestamp;
+		uint32_t frames;
+	};
+
+	pending _pending[capacity];
+	size_t _size = 0;
+};
+
+#endif
@@ -0,0 +1,144 @@
+#include "level.hpp"
+
+#include "mapped_file.hpp"
+
+#include <lak/debug.hpp>
+
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+
+// Bump this whenever the layout below changes.
+static constexpr uint32_t level_version = 1;
+
+enum level_flag : uint32_t
+{
+	LEVEL_HAS_STATE = 1U << 0,
+};
+
+// Followed by width * height tile bytes, then if LEVEL_HAS_STATE is set the
+// actor, block, coin and light frame_states and the collected coin bitset.
+struct level_header
+{
+	char magic[4];
+	uint32_t version;
+	uint64_t width;
+	uint64_t height;
+	uint64_t block_count;
+	uint64_t coin_count;
+	uint64_t light_count;
+	uint32_t flags;
+	uint32_t game_state;
+};
+
+static_assert(std::is_trivially_copyable_v<frame_state>);
+
+// Copies the next `count` elements out of the file, returns false if that
+// would read past the end.
+template<typename T>
+static bool read_section(const char *&data,
+                         const char *end,
+                         T *out,
+                         size_t count)
+{
+	if (count > size_t(end - data) / sizeof(T)) return false;
+	std::memcpy(out, data, count * sizeof(T));
+	data += count * sizeof(T);
+	return true;
+}
+
+template<typename T>
+static bool read_section(const char *&data,
+                         const char *end,
+                         lak::array<T> &out,
+                         size_t count)
+{
+	if (count > size_t(end - data) / sizeof(T)) return false;
+	out.resize(count);
+	return read_section(data, end, out.data(), count);
+}
+
+lak::optional<level> load_level(const lak::fs::path &path)
+{
+	auto file = mapped_file::open(path);
+	if (!file) return lak::nullopt;
+
+	const char *data = file->data();
+	const char *end  = data + file->size();
+
+	level_header header;
+	if (!read_section(data, end, &header, 1)) return lak::nullopt;
+	if (std::memcmp(header.magic, "BGLV", 4) != 0 ||
+	    header.version != level_version)
+		return lak::nullopt;
+	if (header.height != 0 && header.width > file->size() / header.height)
+		return lak::nullopt;
+
+	level result;
+	result.map.width  = header.width;
+	result.map.height = header.height;
+	if (!read_section(data, end, result.map.tiles, header.width * header.height))
+		return lak::nullopt;
+
+	result.has_state = (header.flags & LEVEL_HAS_STATE) != 0;
+	if (result.has_state)
+	{
+		result.game_state = header.game_state;
+
+		const size_t collected_words = coin_bitset_words(header.coin_count);
+		if (!read_section(data, end, result.actors, LEVEL_ACTOR_COUNT) ||
+		    !read_section(data, end, result.blocks, header.block_count) ||
+		    !read_section(data, end, result.coins, header.coin_count) ||
+		    !read_section(data, end, result.lights, header.light_count) ||
+		    !read_section(data, end, result.collected, collected_words))
+			return lak::nullopt;
+	}
+
+	if (data != end) return lak::nullopt;
+
+	return lak::optional<level>(std::move(result));
+}
+
+bool save_level(const lak::fs::path &path, const level &data)
+{
+	std::error_code ec;
+	if (path.has_parent_path())
+		lak::fs::create_directories(path.parent_path(), ec);
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file) return false;
+
+	level_header header = {
+	  .magic       = {'B', 'G', 'L', 'V'},
+	  .version     = level_version,
+	  .width       = data.map.width,
+	  .height      = data.map.height,
+	  .block_count = data.blocks.size(),
+	  .coin_count  = data.coins.size(),
+	  .light_count = data.lights.size(),
+	  .flags       = data.has_state ? LEVEL_HAS_STATE : 0U,
+	  .game_state  = data.game_state,
+	};
+	file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char *>(data.map.tiles.data()),
+	           data.map.tiles.size());
+
+	if (data.has_state)
+	{
+		ASSERT_EQUAL(data.collected.size(),
+		             coin_bitset_words(data.coins.size()));
+		auto write = [&](const auto &section)
+		{
+			file.write(reinterpret_cast<const char *>(section.data()),
+			           section.size() * sizeof(section[0]));
+		};
+		file.write(reinterpret_cast<const char *>(data.actors),
+		           sizeof(data.actors));
+		write(data.blocks);
+		write(data.coins);
+		write(data.lights);
+		write(data.collected);
+	}
+
+	return bool(file);
+}
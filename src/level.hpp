@@ -0,0 +1,89 @@
+#ifndef LEVEL_HPP
+#define LEVEL_HPP
+
+#include "space.hpp"
+#include "tile_grid.hpp"
+
+#include <lak/array.hpp>
+#include <lak/file.hpp>
+#include <lak/optional.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+// The animated part of a reference_frame.
+struct frame_state
+{
+	delta_transform translation;
+	delta_transform rotation;
+	delta_transform scale;
+};
+
+inline frame_state get_frame_state(const reference_frame &frame)
+{
+	return {frame.translation, frame.rotation, frame.scale};
+}
+
+inline void set_frame_state(reference_frame &frame, const frame_state &state)
+{
+	frame.translation = state.translation;
+	frame.rotation    = state.rotation;
+	frame.scale       = state.scale;
+}
+
+// Frames that aren't tile entities.
+enum level_actor
+{
+	LEVEL_WORLD,
+	LEVEL_PLAYER,
+	LEVEL_CAMERA_BOOM,
+	LEVEL_CAMERA,
+	LEVEL_BALL,
+	LEVEL_ACTOR_COUNT
+};
+
+// Number of uint64_t words in a collected coin bitset.
+inline size_t coin_bitset_words(size_t coin_count)
+{
+	return (coin_count + 63) / 64;
+}
+
+// A tile grid and optionally a session in progress on it. Entity state is in
+// the same column major order that the map's entities are built in.
+struct level
+{
+	tile_grid map;
+
+	// false for a level that starts from the map, true for a save.
+	bool has_state      = false;
+	uint32_t game_state = 0;
+	frame_state actors[LEVEL_ACTOR_COUNT];
+	lak::array<frame_state> blocks;
+	lak::array<frame_state> coins;
+	lak::array<frame_state> lights;
+	// bit i set if coin i has been collected, coin_bitset_words(coins.size())
+	// words long.
+	lak::array<uint64_t> collected;
+
+	bool coin_collected(size_t i) const
+	{
+		return (collected[i / 64] >> (i % 64)) & 1U;
+	}
+
+	void set_coin_collected(size_t i, bool value)
+	{
+		const uint64_t bit = uint64_t(1) << (i % 64);
+		if (value)
+			collected[i / 64] |= bit;
+		else
+			collected[i / 64] &= ~bit;
+	}
+};
+
+// Maps the file and copies each section out of it in order. Returns nullopt
+// if the file is missing, truncated or from a different version.
+lak::optional<level> load_level(const lak::fs::path &path);
+
+bool save_level(const lak::fs::path &path, const level &data);
+
+#endif
@@ -0,0 +1,278 @@
+#include "light_bake.hpp"
+
+#include "mapped_file.hpp"
+#include "parallel.hpp"
+
+#include <glm/geometric.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+// Bump this whenever the baked output changes for the same inputs.
+static constexpr uint32_t bake_version = 1;
+
+struct bake_cache_header
+{
+	char magic[4];
+	uint32_t version;
+	uint64_t key;
+	uint64_t colour_count;
+};
+
+static bool is_block(const tile_grid &map, ptrdiff_t x, ptrdiff_t y)
+{
+	return x >= 0 && y >= 0 && size_t(x) < map.width &&
+	       size_t(y) < map.height && map.has(size_t(x), size_t(y), TILE_BLOCK);
+}
+
+static float sign(float value)
+{
+	return value > 0.0f ? 1.0f : (value < 0.0f ? -1.0f : 0.0f);
+}
+
+// Tile offset that a side facing normal points at, world +y is tile -y.
+// Returns false for faces pointing up or down.
+static bool facing_tile(const glm::vec3 &normal, ptrdiff_t &dx, ptrdiff_t &dy)
+{
+	if (std::abs(normal.x) >= 0.5f)
+	{
+		dx = ptrdiff_t(sign(normal.x));
+		dy = 0;
+		return true;
+	}
+	if (std::abs(normal.y) >= 0.5f)
+	{
+		dx = 0;
+		dy = -ptrdiff_t(sign(normal.y));
+		return true;
+	}
+	return false;
+}
+
+// Blocks all sit at the same height, so the only occluders are blocks
+// diagonally in front of a side face, which form a concave corner with it.
+// Top and bottom faces are never occluded: neighbouring tops are flush and
+// nothing sits above a block.
+static float ambient_occlusion(const tile_grid &map,
+                               size_t x,
+                               size_t y,
+                               const vertex &v)
+{
+	const glm::vec3 normal = v.norm;
+	ptrdiff_t dx, dy;
+	if (!facing_tile(normal, dx, dy)) return 1.0f;
+
+	if (dx != 0)
+		dy = -ptrdiff_t(sign(v.pos.y));
+	else
+		dx = ptrdiff_t(sign(v.pos.x));
+
+	return is_block(map, ptrdiff_t(x) + dx, ptrdiff_t(y) + dy) ? 0.5f : 1.0f;
+}
+
+// Builds the chunk's world space geometry, with the ambient occlusion
+// stashed in the vertex colour for the lighting pass.
+static baked_chunk build_chunk(const tile_grid &map,
+                               size_t chunk_x,
+                               size_t chunk_y,
+                               const lak::array<vertex> &block_vertices)
+{
+	baked_chunk result;
+
+	const size_t x_end = std::min(map.width, (chunk_x + 1) * bake_chunk_size);
+	const size_t y_end = std::min(map.height, (chunk_y + 1) * bake_chunk_size);
+
+	for (size_t y = chunk_y * bake_chunk_size; y < y_end; ++y)
+	{
+		for (size_t x = chunk_x * bake_chunk_size; x < x_end; ++x)
+		{
+			if (!map.has(x, y, TILE_BLOCK)) continue;
+
+			const auto tile   = tile_position(x, y);
+			const auto offset = glm::vec4{tile.x, tile.y, block_z, 0.0f};
+
+			for (size_t i = 0; i + 2 < block_vertices.size(); i += 3)
+			{
+				ptrdiff_t dx, dy;
+				if (facing_tile(block_vertices[i].norm, dx, dy) &&
+				    is_block(map, ptrdiff_t(x) + dx, ptrdiff_t(y) + dy))
+					continue;
+
+				for (size_t j = i; j < i + 3; ++j)
+				{
+					vertex v = block_vertices[j];
+					v.col    = glm::vec4(ambient_occlusion(map, x, y, v));
+					v.pos += offset;
+					result.vertices.push_back(v);
+				}
+			}
+		}
+	}
+
+	return result;
+}
+
+static void light_chunk(baked_chunk &chunk,
+                        const lak::array<bake_light> &lights,
+                        const bake_material &material)
+{
+	for (auto &v : chunk.vertices)
+	{
+		const glm::vec3 pos    = glm::vec3(v.pos);
+		const glm::vec3 normal = glm::normalize(v.norm);
+
+		glm::vec4 colour = material.ambient * v.col.x;
+		for (const auto &light : lights)
+		{
+			const glm::vec3 dir = glm::normalize(light.position - pos);
+			const float dNL     = std::max(glm::dot(normal, dir), 0.0f);
+			colour += material.diffuse * light.colour * dNL;
+		}
+		colour.w = 1.0f;
+		v.col    = colour;
+	}
+}
+
+struct fnv1a
+{
+	uint64_t hash = 0xCBF29CE484222325ULL;
+
+	void add(const void *data, size_t size)
+	{
+		const auto *bytes = static_cast<const uint8_t *>(data);
+		for (size_t i = 0; i < size; ++i)
+		{
+			hash ^= bytes[i];
+			hash *= 0x100000001B3ULL;
+		}
+	}
+};
+
+static uint64_t bake_key(const tile_grid &map,
+                         const lak::array<vertex> &block_vertices,
+                         const lak::array<bake_light> &lights,
+                         const bake_material &material)
+{
+	fnv1a key;
+	key.add(&bake_version, sizeof(bake_version));
+	key.add(&bake_chunk_size, sizeof(bake_chunk_size));
+	key.add(&map.width, sizeof(map.width));
+	key.add(&map.height, sizeof(map.height));
+	key.add(map.tiles.data(), map.tiles.size());
+	key.add(block_vertices.data(), block_vertices.size() * sizeof(vertex));
+	key.add(lights.data(), lights.size() * sizeof(bake_light));
+	key.add(&material, sizeof(material));
+	return key.hash;
+}
+
+static lak::fs::path bake_cache_path(const lak::fs::path &cache_dir,
+                                     uint64_t key)
+{
+	char name[64];
+	std::snprintf(name,
+	              sizeof(name),
+	              "lighting_%016llx.bin",
+	              static_cast<unsigned long long>(key));
+	return cache_dir / name;
+}
+
+static bool load_bake_cache(const lak::fs::path &path,
+                            uint64_t key,
+                            size_t colour_count,
+                            lak::array<baked_chunk> &chunks)
+{
+	auto file = mapped_file::open(path);
+	if (!file) return false;
+
+	bake_cache_header header;
+	if (file->size() != sizeof(header) + (colour_count * sizeof(glm::vec4)))
+		return false;
+	std::memcpy(&header, file->data(), sizeof(header));
+	if (std::memcmp(header.magic, "BGLC", 4) != 0 ||
+	    header.version != bake_version || header.key != key ||
+	    header.colour_count != colour_count)
+		return false;
+
+	const char *colours = file->data() + sizeof(header);
+	for (auto &chunk : chunks)
+	{
+		for (auto &v : chunk.vertices)
+		{
+			std::memcpy(&v.col, colours, sizeof(v.col));
+			colours += sizeof(v.col);
+		}
+	}
+	return true;
+}
+
+static void save_bake_cache(const lak::fs::path &path,
+                            uint64_t key,
+                            size_t colour_count,
+                            const lak::array<baked_chunk> &chunks)
+{
+	std::error_code ec;
+	lak::fs::create_directories(path.parent_path(), ec);
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file) return;
+
+	bake_cache_header header = {
+	  .magic        = {'B', 'G', 'L', 'C'},
+	  .version      = bake_version,
+	  .key          = key,
+	  .colour_count = colour_count,
+	};
+	file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	for (const auto &chunk : chunks)
+		for (const auto &v : chunk.vertices)
+			file.write(reinterpret_cast<const char *>(&v.col), sizeof(v.col));
+}
+
+lak::array<baked_chunk> bake_static_blocks(
+  const tile_grid &map,
+  const lak::array<vertex> &block_vertices,
+  const lak::array<bake_light> &lights,
+  const bake_material &material,
+  const lak::fs::path &cache_dir)
+{
+	const size_t chunks_x =
+	  (map.width + bake_chunk_size - 1) / bake_chunk_size;
+	const size_t chunks_y =
+	  (map.height + bake_chunk_size - 1) / bake_chunk_size;
+	const size_t chunk_count = chunks_x * chunks_y;
+
+	lak::array<baked_chunk> chunks;
+	chunks.resize(chunk_count);
+
+	parallel_ranges(chunk_count,
+	                parallel_range_count(chunk_count),
+	                [&](size_t, size_t begin, size_t end)
+	                {
+		                for (size_t i = begin; i < end; ++i)
+			                chunks[i] = build_chunk(
+			                  map, i % chunks_x, i / chunks_x, block_vertices);
+	                });
+
+	size_t colour_count = 0;
+	for (const auto &chunk : chunks) colour_count += chunk.vertices.size();
+
+	const uint64_t key = bake_key(map, block_vertices, lights, material);
+	const auto path    = bake_cache_path(cache_dir, key);
+	if (load_bake_cache(path, key, colour_count, chunks)) return chunks;
+
+	parallel_ranges(chunk_count,
+	                parallel_range_count(chunk_count),
+	                [&](size_t, size_t begin, size_t end)
+	                {
+		                for (size_t i = begin; i < end; ++i)
+			                light_chunk(chunks[i], lights, material);
+	                });
+
+	save_bake_cache(path, key, colour_count, chunks);
+
+	return chunks;
+}
@@ -0,0 +1,47 @@
+#ifndef LIGHT_BAKE_HPP
+#define LIGHT_BAKE_HPP
+
+#include "tile_grid.hpp"
+#include "vertex.hpp"
+
+#include <lak/array.hpp>
+#include <lak/file.hpp>
+
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+struct bake_light
+{
+	glm::vec3 position;
+	glm::vec4 colour;
+};
+
+struct bake_material
+{
+	glm::vec4 ambient;
+	glm::vec4 diffuse;
+};
+
+// Tiles per side of a baked chunk.
+constexpr size_t bake_chunk_size = 16;
+
+// A chunk of static blocks merged into one world space mesh, with ambient
+// (scaled by ambient occlusion) and diffuse lighting from every light baked
+// into the vertex colours. Only side faces at concave corners are occluded,
+// the top faces are always fully lit.
+struct baked_chunk
+{
+	lak::array<vertex> vertices;
+};
+
+// Bakes every block in `map` into chunks of `bake_chunk_size` tiles. Faces
+// hidden by a neighbouring block are dropped. Chunks are baked in parallel
+// and the lighting is cached in `cache_dir`, keyed by a hash of the inputs.
+lak::array<baked_chunk> bake_static_blocks(
+  const tile_grid &map,
+  const lak::array<vertex> &block_vertices,
+  const lak::array<bake_light> &lights,
+  const bake_material &material,
+  const lak::fs::path &cache_dir);
+
+#endif
@@ -5,7 +5,6 @@
 
 #include <lak/file.hpp>
 
-#include <lak/structure/obj.hpp>
 #include <lak/structure/pnm.hpp>
 
 #include <lak/opengl/mesh.hpp>
@@ -18,9 +17,26 @@
 #include <glm/ext/matrix_clip_space.hpp>
 #include <glm/ext/matrix_transform.hpp>
 
+#include "alloc_tracker.hpp"
+#include "batch_sim.hpp"
+#include "input.hpp"
+#include "level.hpp"
+#include "light_bake.hpp"
+#include "obj_loader.hpp"
+#include "parallel.hpp"
+#include "pipeline.hpp"
 #include "space.hpp"
+#include "tile_grid.hpp"
+#include "uniform_buffer.hpp"
+#include "vertex.hpp"
 
+#include <algorithm>
+#include <cfloat>
 #include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 
 enum state_t
 {
@@ -62,84 +78,20 @@ struct camera
 	}
 };
 
+constexpr glm::vec4 light_colour   = {0.5f, 0.5f, 0.5f, 1.0f};
+constexpr glm::vec4 ambient_colour = {0.1f, 0.1f, 0.1f, 1.0f};
+constexpr glm::vec4 diffuse_colour = {1.0f, 1.0f, 1.0f, 1.0f};
+
 struct light
 {
-	lak::shared_ptr<reference_frame> frame;
-	glm::vec4 colour = {0.5f, 0.5f, 0.5f, 1.0f};
+	reference_frame *frame;
+	glm::vec4 colour = light_colour;
 };
 
 struct model
 {
-	lak::shared_ptr<reference_frame> frame;
+	reference_frame *frame;
 	lak::shared_ptr<lak::opengl::static_object_part> mesh;
-
-	void draw()
-	{
-		auto model_transform = frame->get_transform();
-		mesh->shader()->assert_set_uniform("model",
-		                                   lak::as_bytes(&model_transform));
-		mesh->draw();
-	}
-};
-
-struct vertex
-{
-	glm::vec4 pos;
-	glm::vec4 col;
-	glm::vec3 norm;
-	glm::vec2 tex_coord;
-
-	static lak::array<lak::opengl::vertex_attribute> attributes()
-	{
-		return lak::array<lak::opengl::vertex_attribute>{
-		  {
-		    .size       = 4,
-		    .type       = GL_FLOAT,
-		    .normalised = GL_FALSE,
-		    .stride     = sizeof(vertex),
-		    .offset     = offsetof(vertex, pos),
-		    .divisor    = 0,
-		  },
-		  {
-		    .size       = 4,
-		    .type       = GL_FLOAT,
-		    .normalised = GL_FALSE,
-		    .stride     = sizeof(vertex),
-		    .offset     = offsetof(vertex, col),
-		    .divisor    = 0,
-		  },
-		  {
-		    .size       = 3,
-		    .type       = GL_FLOAT,
-		    .normalised = GL_FALSE,
-		    .stride     = sizeof(vertex),
-		    .offset     = offsetof(vertex, norm),
-		    .divisor    = 0,
-		  },
-		  {
-		    .size       = 2,
-		    .type       = GL_FLOAT,
-		    .normalised = GL_FALSE,
-		    .stride     = sizeof(vertex),
-		    .offset     = offsetof(vertex, tex_coord),
-		    .divisor    = 0,
-		  }};
-	}
-
-	static lak::array<GLuint, 4U> attribute_indices(
-	  const lak::opengl::program &shader,
-	  const GLchar *pos_name,
-	  const GLchar *col_name,
-	  const GLchar *norm_name,
-	  const GLchar *tex_coord_name)
-	{
-		return lak::array<GLuint, 4U>{
-		  shader.assert_attrib_index(pos_name),
-		  shader.assert_attrib_index(col_name),
-		  shader.assert_attrib_index(norm_name),
-		  shader.assert_attrib_index(tex_coord_name),
-		};
-	}
 };
 
 lak::shared_ptr<lak::opengl::static_object_part> make_mesh(
@@ -162,37 +114,6 @@ lak::shared_ptr<lak::opengl::static_object_part> make_mesh(
 	    {{albedo, shader->assert_uniform_location("albedo")}}));
 }
 
-lak::array<vertex> load_model_file(const lak::fs::path &path)
-{
-	auto model_file = lak::read_file(path).EXPECT("failed to open ", path);
-	lak::binary_reader strm{model_file};
-	auto obj = strm.read<lak::obj::obj>().EXPECT("failed to read obj ", path);
-	lak::array<vertex> result;
-	for (const auto &face : obj.faces)
-	{
-		face.visit_fan(
-		  obj.vertex_coords,
-		  obj.texture_coords,
-		  obj.vertex_normals,
-		  obj.face_coords,
-		  [&](const lak::obj::vertex_coord &v,
-		      const lak::obj::texture_coord *vt,
-		      const lak::obj::vertex_normal *vn)
-		  {
-			  result.push_back(vertex{
-			    .pos  = glm::vec4{float(v.x), float(v.z), float(v.y), float(v.w)},
-			    .col  = glm::vec4{1.0, 1.0, 1.0, 1.0},
-			    .norm = vn ? glm::vec3{float(vn->x), float(vn->z), float(vn->y)}
-			               : glm::vec3{0.0},
-			    // lak::image is top-left origin, opengl is bottom-left
-			    .tex_coord =
-			      vt ? glm::vec2{float(vt->u), -float(vt->v)} : glm::vec2{0.0},
-			  });
-		  });
-	}
-	return result;
-}
-
 lak::image3_t load_texture3_file(const lak::fs::path &path)
 {
 	auto tex_file = lak::read_file(path).EXPECT("failed to open ", path);
@@ -220,6 +141,181 @@ lak::opengl::texture load_opengl_texture(const lak::image3_t &img)
 	return tex;
 }
 
+// Rows or columns of the map per thread when building from it.
+constexpr size_t map_min_lines_per_thread = 64;
+
+tile_grid make_tile_grid(const lak::image3_t &map)
+{
+	tile_grid result{.width = map.size().x, .height = map.size().y};
+	result.tiles.resize(result.width * result.height);
+	parallel_ranges(
+	  result.height,
+	  parallel_range_count(result.height, map_min_lines_per_thread),
+	  [&](size_t, size_t begin, size_t end)
+	  {
+		  for (size_t y = begin; y < end; y++)
+		  {
+			  for (size_t x = 0; x < result.width; x++)
+			  {
+				  const auto &pixel = map[{x, y}];
+				  uint8_t tile      = 0;
+				  if (pixel.r > 0) tile |= TILE_BLOCK;
+				  if (pixel.g > 0) tile |= TILE_COIN;
+				  if (pixel.b > 0) tile |= TILE_LIGHT;
+				  result.tiles[x + (y * result.width)] = tile;
+			  }
+		  }
+	  });
+	return result;
+}
+
+// Headless throughput test: steps `sessions` independent sessions of the map
+// `steps` times with a random input policy, restarting sessions as they win
+// or lose.
+int run_batch_simulation(size_t sessions, size_t steps)
+{
+	const auto map =
+	  make_tile_grid(load_texture3_file(lak::fs::path("assets") / "map.ppm"));
+
+	batch_simulation sim(map, sessions);
+
+	lak::array<uint32_t> rng;
+	rng.resize(sessions);
+	for (size_t i = 0; i < sessions; i++)
+		rng[i] = static_cast<uint32_t>((i * 2654435761U) | 1U);
+
+	constexpr float delta = 1.0f / 60.0f;
+	uint64_t sim_counter  = 0;
+	size_t episodes       = 0;
+	for (size_t step = 0; step < steps; step++)
+	{
+		for (size_t i = 0; i < sessions; i++)
+		{
+			uint32_t &r = rng[i];
+			r ^= r << 13;
+			r ^= r >> 17;
+			r ^= r << 5;
+			sim.turn[i] = float(int(r % 3U) - 1);
+			sim.roll[i] = ((r >> 8) % 4U) ? 1.0f : -1.0f;
+		}
+
+		const uint64_t start = lak::performance_counter();
+		sim.step(delta);
+		sim_counter += lak::performance_counter() - start;
+
+		episodes += sim.reset_finished();
+	}
+
+	const double seconds = double(sim_counter) / lak::performance_frequency();
+	std::printf("%zu sessions x %zu steps in %.3fs (%zu episodes finished)\n",
+	            sessions,
+	            steps,
+	            seconds,
+	            episodes);
+	std::printf("%.0f session-steps/s\n",
+	            seconds > 0.0 ? double(sessions * steps) / seconds : 0.0);
+
+	return EXIT_SUCCESS;
+}
+
+// Headless check that the specialised reference_frame::get_transform kernels
+// match get_transform_reference for random frames, with every combination of
+// identity and non-identity rotation axes and scale, with and without a
+// parent.
+int run_transform_test(size_t count)
+{
+	uint32_t rng = 0x9E3779B9U;
+	auto next    = [&]
+	{
+		rng ^= rng << 13;
+		rng ^= rng >> 17;
+		rng ^= rng << 5;
+		return rng;
+	};
+	auto random_float = [&](float min, float max)
+	{ return min + (max - min) * float(next() >> 8) / float(1U << 24); };
+
+	constexpr float tolerance = 1e-4f;
+	size_t failures           = 0;
+	float worst_error         = 0.0f;
+
+	reference_frame parent;
+	for (size_t i = 0; i < count; i++)
+	{
+		reference_frame frame;
+		const uint32_t shape = next();
+		frame.parent         = (shape & 16) ? &parent : nullptr;
+		frame.translation.value =
+		  glm::vec3(random_float(-50.0f, 50.0f),
+		            random_float(-50.0f, 50.0f),
+		            random_float(-50.0f, 50.0f));
+		if (shape & 1) frame.rotation.value.x = random_float(0.0f, 6.3f);
+		if (shape & 2) frame.rotation.value.y = random_float(0.0f, 6.3f);
+		if (shape & 4) frame.rotation.value.z = random_float(0.0f, 6.3f);
+		if (shape & 8)
+			frame.scale.value = glm::vec3(random_float(0.1f, 4.0f),
+			                              random_float(0.1f, 4.0f),
+			                              random_float(0.1f, 4.0f));
+
+		if (frame.parent)
+		{
+			parent.translation.value = glm::vec3(random_float(-50.0f, 50.0f),
+			                                     random_float(-50.0f, 50.0f),
+			                                     random_float(-50.0f, 50.0f));
+			parent.rotation.value    = glm::vec3(random_float(0.0f, 6.3f),
+			                                     random_float(0.0f, 6.3f),
+			                                     random_float(0.0f, 6.3f));
+		}
+
+		const glm::mat4 fast      = frame.get_transform();
+		const glm::mat4 reference = frame.get_transform_reference();
+
+		float error = 0.0f;
+		for (glm::length_t c = 0; c < 4; c++)
+			for (glm::length_t r = 0; r < 4; r++)
+				error = std::max(error,
+				                 std::abs(fast[c][r] - reference[c][r]) /
+				                   std::max(1.0f, std::abs(reference[c][r])));
+		worst_error = std::max(worst_error, error);
+
+		if (error > tolerance)
+		{
+			if (failures++ < 8)
+				std::printf("frame %zu (shape %u): error %g\n",
+				            i,
+				            unsigned(shape & 31),
+				            double(error));
+		}
+	}
+
+	std::printf("%zu frames, %zu failures, worst relative error %g\n",
+	            count,
+	            failures,
+	            double(worst_error));
+
+	return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Writes assets/map.ppm out as a binary level, which is loaded in place of
+// the texture when it's saved as assets/map.bglv.
+int export_level(const lak::fs::path &path)
+{
+	level result;
+	result.map =
+	  make_tile_grid(load_texture3_file(lak::fs::path("assets") / "map.ppm"));
+
+	if (!save_level(path, result))
+	{
+		std::printf("failed to write %s\n", path.string().c_str());
+		return EXIT_FAILURE;
+	}
+
+	std::printf("wrote %zux%zu level to %s\n",
+	            result.map.width,
+	            result.map.height,
+	            path.string().c_str());
+	return EXIT_SUCCESS;
+}
 
 struct scene
 {
@@ -229,23 +325,123 @@ struct scene
 	lak::shared_ptr<reference_frame> cameraBoom;
 	::camera camera;
 	lak::array<light> lights;
-	lak::array<model> blocks;
-	lak::array<model> coins;
-	lak::array<model> coins_reset;
+	// blocks and coins have no per entity mesh, so only their frames are kept.
+	lak::array<reference_frame *> blocks;
+	lak::array<reference_frame *> coins;
+	lak::array<reference_frame *> coins_reset;
+	// storage for the frames of every light, block and coin.
+	lak::array<reference_frame> light_frames;
+	lak::array<reference_frame> block_frames;
+	lak::array<reference_frame> coin_frames;
 	model ball;
+	// blocks never move, they're drawn from these pre-lit meshes.
+	lak::array<lak::shared_ptr<lak::opengl::static_object_part>> static_chunks;
+	lak::shared_ptr<lak::opengl::static_object_part> coin_mesh;
+	// camera and lights, only uploaded when they change.
+	frame_uniforms frame_data = {};
+	lak::shared_ptr<uniform_block<frame_uniforms>> frame_block;
+	// per draw data for every static chunk, the ball and every coin.
+	lak::shared_ptr<uniform_ring_buffer<object_uniforms>> object_ring;
+};
+
+// Everything the renderer needs from one simulation tick.
+struct scene_snapshot
+{
+	glm::mat4 view = glm::mat4(1.0f);
+	glm::mat4 ball = glm::mat4(1.0f);
+	lak::array<glm::mat4> coins;
+};
+
+struct input_latency
+{
+	latency_histogram to_sim;
+	latency_histogram to_present;
+	present_latency_tracker pending_present;
 };
 
 struct user_data
 {
 	scene scene;
+	input_queue input_events;
+	player_input input;
+	input_latency latency;
+	scene_snapshot snapshot;
+	bool pipelined   = false;
+	bool low_latency = false;
 };
 
 user_data ud;
 
+struct alloc_stats
+{
+	alloc_counts frame_start[ALLOC_PHASE_COUNT];
+	alloc_counts last_frame[ALLOC_PHASE_COUNT];
+	uint64_t last_frame_allocations = 0;
+	// most allocations made by a single steady state RUNNING frame.
+	uint64_t worst_running_frame = 0;
+	bool running_at_start        = false;
+	// the last frame was RUNNING from start to finish.
+	bool last_frame_running = false;
+
+	void begin_frame()
+	{
+		last_frame_allocations = 0;
+		for (size_t i = 0; i < ALLOC_PHASE_COUNT; i++)
+		{
+			const auto total = alloc_totals(alloc_phase(i));
+			last_frame[i]    = total - frame_start[i];
+			frame_start[i]   = total;
+			last_frame_allocations += last_frame[i].allocations;
+		}
+		if (last_frame_running)
+			worst_running_frame =
+			  std::max(worst_running_frame, last_frame_allocations);
+		running_at_start = state == RUNNING;
+	}
+
+	// running_at_end must be sampled before the pipeline is kicked, the
+	// worker thread owns state until the next pipeline.wait().
+	void end_frame(bool running_at_end)
+	{
+		last_frame_running = running_at_start && running_at_end;
+	}
+};
+
+alloc_stats allocs;
+
+// --alloc-test: after a warmup, fail if any steady state RUNNING frame
+// allocates, pass after alloc_test_frames frames.
+bool alloc_test                    = false;
+size_t alloc_test_frame            = 0;
+constexpr size_t alloc_test_warmup = 120;
+constexpr size_t alloc_test_frames = 600;
+
+// Steps the simulation on a worker thread while the window thread renders
+// the previous tick, adding one frame of latency.
+sim_pipeline<scene_snapshot> pipeline;
+float pipeline_frame_time = 0.0f;
+
 lak::optional<int> basic_program_init(int argc, char **argv)
 {
-	LAK_UNUSED(argc);
-	LAK_UNUSED(argv);
+	// ImGui allocates through its own hooks rather than operator new. Both
+	// are malloc underneath, so it doesn't matter if ImGui has already
+	// allocated anything with the default hooks.
+	ImGui::SetAllocatorFunctions(
+	  [](size_t size, void *) { return alloc_tracked_malloc(size); },
+	  [](void *ptr, void *) { alloc_tracked_free(ptr); });
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--batch") == 0 && i + 2 < argc)
+			return run_batch_simulation(std::strtoull(argv[i + 1], nullptr, 10),
+			                            std::strtoull(argv[i + 2], nullptr, 10));
+		else if (std::strcmp(argv[i], "--export-level") == 0 && i + 1 < argc)
+			return export_level(argv[i + 1]);
+		else if (std::strcmp(argv[i], "--transform-test") == 0)
+			return run_transform_test(100000);
+		else if (std::strcmp(argv[i], "--alloc-test") == 0)
+			alloc_test = true;
+	}
 
 	basic_window_target_framerate                = 60;
 	basic_window_opengl_settings.major           = 3;
@@ -266,7 +462,9 @@ bool basic_program_loop(uint64_t counter_delta)
 	return game_running && !basic_window_instances.empty();
 }
 
-int basic_program_quit() { return EXIT_SUCCESS; }
+int exit_code = EXIT_SUCCESS;
+
+int basic_program_quit() { return exit_code; }
 
 std::atomic_bool assets_loaded = false;
 
@@ -276,7 +474,14 @@ lak::image3_t cube_texture;
 lak::array<vertex> cube_vertices;
 lak::image3_t coin_texture;
 lak::array<vertex> coin_vertices;
-lak::image3_t map_texture;
+tile_grid map_tiles;
+lak::array<baked_chunk> static_chunks;
+// applied once the scene has been built, if map.bglv was a save.
+lak::optional<level> startup_save;
+state_t startup_state = RUNNING;
+
+const lak::fs::path quicksave_path = lak::fs::path("saves") / "quicksave.bglv";
+double last_save_load_seconds      = 0.0;
 
 void load_assets()
 {
@@ -291,11 +496,220 @@ void load_assets()
 	coin_texture  = load_texture3_file(assets_dir / "coin.ppm");
 	coin_vertices = load_model_file(assets_dir / "coin.obj");
 
-	map_texture = load_texture3_file(assets_dir / "map.ppm");
+	// a binary level skips decoding the map texture, and if it's a save it
+	// also resumes the session it was saved from.
+	if (auto saved = load_level(assets_dir / "map.bglv"); saved)
+	{
+		map_tiles = saved->map;
+		if (saved->has_state) startup_save = std::move(saved);
+	}
+	else
+		map_tiles = make_tile_grid(load_texture3_file(assets_dir / "map.ppm"));
+
+	lak::array<bake_light> lights;
+	for (size_t y = 0; y < map_tiles.height; y++)
+	{
+		for (size_t x = 0; x < map_tiles.width; x++)
+		{
+			if (!map_tiles.has(x, y, TILE_LIGHT)) continue;
+			const auto pos = tile_position(x, y);
+			lights.push_back(bake_light{
+			  .position = {pos.x, pos.y, light_z},
+			  .colour   = light_colour,
+			});
+		}
+	}
+
+	static_chunks = bake_static_blocks(
+	  map_tiles,
+	  cube_vertices,
+	  lights,
+	  {.ambient = ambient_colour, .diffuse = diffuse_colour},
+	  "cache");
 
 	assets_loaded = true;
 }
 
+// Builds every block, coin and light in a single parallel pass over columns
+// of the map: each range of columns counts its entities, a prefix sum gives
+// each range its offset, then each range constructs its entities in place in
+// the scene's preallocated storage. Entities stay in the column major order
+// the map was originally scanned in.
+void build_scene_entities(scene &scene, const tile_grid &map)
+{
+	struct entity_counts
+	{
+		size_t blocks = 0;
+		size_t coins  = 0;
+		size_t lights = 0;
+	};
+
+	const size_t range_count =
+	  parallel_range_count(map.width, map_min_lines_per_thread);
+
+	// offsets[i] is the first entity of range i, offsets[range_count] the total.
+	lak::array<entity_counts> offsets;
+	offsets.resize(range_count + 1);
+
+	parallel_ranges(map.width,
+	                range_count,
+	                [&](size_t range, size_t begin, size_t end)
+	                {
+		                entity_counts counts;
+		                for (size_t x = begin; x < end; x++)
+		                {
+			                for (size_t y = 0; y < map.height; y++)
+			                {
+				                const uint8_t tile = map.at(x, y);
+				                if (tile & TILE_BLOCK) counts.blocks++;
+				                if (tile & TILE_COIN) counts.coins++;
+				                if (tile & TILE_LIGHT) counts.lights++;
+			                }
+		                }
+		                offsets[range + 1] = counts;
+	                });
+
+	for (size_t i = 1; i <= range_count; i++)
+	{
+		offsets[i].blocks += offsets[i - 1].blocks;
+		offsets[i].coins += offsets[i - 1].coins;
+		offsets[i].lights += offsets[i - 1].lights;
+	}
+	const entity_counts total = offsets[range_count];
+
+	scene.block_frames.clear();
+	scene.block_frames.resize(total.blocks);
+	scene.blocks.clear();
+	scene.blocks.resize(total.blocks);
+
+	scene.coin_frames.clear();
+	scene.coin_frames.resize(total.coins);
+	scene.coins.clear();
+	scene.coins.resize(total.coins);
+
+	scene.light_frames.clear();
+	scene.light_frames.resize(total.lights);
+	scene.lights.clear();
+	scene.lights.resize(total.lights);
+
+	parallel_ranges(
+	  map.width,
+	  range_count,
+	  [&](size_t range, size_t begin, size_t end)
+	  {
+		  entity_counts next = offsets[range];
+		  for (size_t x = begin; x < end; x++)
+		  {
+			  for (size_t y = 0; y < map.height; y++)
+			  {
+				  const uint8_t tile = map.at(x, y);
+				  if (!tile) continue;
+
+				  const auto pos = tile_position(x, y);
+
+				  if (tile & TILE_BLOCK)
+				  {
+					  auto &frame                 = scene.block_frames[next.blocks];
+					  frame.translation.value     = {pos.x, pos.y, block_z};
+					  scene.blocks[next.blocks++] = &frame;
+				  }
+
+				  if (tile & TILE_COIN)
+				  {
+					  auto &frame               = scene.coin_frames[next.coins];
+					  frame.translation.value   = {pos.x, pos.y, coin_z};
+					  frame.rotation.velocity.z = 1.0f;
+					  scene.coins[next.coins++] = &frame;
+				  }
+
+				  if (tile & TILE_LIGHT)
+				  {
+					  auto &frame             = scene.light_frames[next.lights];
+					  frame.translation.value = {pos.x, pos.y, light_z};
+					  scene.lights[next.lights++] =
+					    light{.frame = &frame, .colour = light_colour};
+				  }
+			  }
+		  }
+	  });
+
+	scene.coins_reset = scene.coins;
+}
+
+// Captures the session in progress so it can be resumed by apply_save.
+level make_save(const scene &scene, const tile_grid &map, state_t game_state)
+{
+	level result;
+	result.map        = map;
+	result.has_state  = true;
+	result.game_state = uint32_t(game_state);
+
+	result.actors[LEVEL_WORLD]       = get_frame_state(*scene.world);
+	result.actors[LEVEL_PLAYER]      = get_frame_state(*scene.player);
+	result.actors[LEVEL_CAMERA_BOOM] = get_frame_state(*scene.cameraBoom);
+	result.actors[LEVEL_CAMERA]      = get_frame_state(*scene.camera.frame);
+	result.actors[LEVEL_BALL]        = get_frame_state(*scene.ball.frame);
+
+	auto save_frames = [](lak::array<frame_state> &out,
+	                      const lak::array<reference_frame> &frames)
+	{
+		out.resize(frames.size());
+		for (size_t i = 0; i < frames.size(); i++)
+			out[i] = get_frame_state(frames[i]);
+	};
+	save_frames(result.blocks, scene.block_frames);
+	save_frames(result.coins, scene.coin_frames);
+	save_frames(result.lights, scene.light_frames);
+
+	// coins are removed from scene.coins when collected, so everything not
+	// still in it has been collected.
+	result.collected.resize(coin_bitset_words(scene.coin_frames.size()));
+	std::fill(result.collected.begin(), result.collected.end(), ~uint64_t(0));
+	for (const auto *coin : scene.coins)
+		result.set_coin_collected(size_t(coin - scene.coin_frames.data()), false);
+
+	return result;
+}
+
+// Restores a session saved by make_save on to a scene built from the same
+// map. Returns false if the save is for a different map.
+bool apply_save(scene &scene, const tile_grid &map, const level &save)
+{
+	if (!save.has_state || save.game_state < RUNNING || save.game_state > LOSS)
+		return false;
+
+	if (save.map.width != map.width || save.map.height != map.height ||
+	    std::memcmp(save.map.tiles.data(),
+	                map.tiles.data(),
+	                map.tiles.size()) != 0)
+		return false;
+
+	if (save.blocks.size() != scene.block_frames.size() ||
+	    save.coins.size() != scene.coin_frames.size() ||
+	    save.lights.size() != scene.light_frames.size())
+		return false;
+
+	set_frame_state(*scene.world, save.actors[LEVEL_WORLD]);
+	set_frame_state(*scene.player, save.actors[LEVEL_PLAYER]);
+	set_frame_state(*scene.cameraBoom, save.actors[LEVEL_CAMERA_BOOM]);
+	set_frame_state(*scene.camera.frame, save.actors[LEVEL_CAMERA]);
+	set_frame_state(*scene.ball.frame, save.actors[LEVEL_BALL]);
+
+	for (size_t i = 0; i < save.blocks.size(); i++)
+		set_frame_state(scene.block_frames[i], save.blocks[i]);
+	for (size_t i = 0; i < save.coins.size(); i++)
+		set_frame_state(scene.coin_frames[i], save.coins[i]);
+	for (size_t i = 0; i < save.lights.size(); i++)
+		set_frame_state(scene.light_frames[i], save.lights[i]);
+
+	// coins_reset[i] is coin_frames[i].
+	scene.coins.clear();
+	for (size_t i = 0; i < scene.coins_reset.size(); i++)
+		if (!save.coin_collected(i)) scene.coins.push_back(scene.coins_reset[i]);
+
+	return true;
+}
+
 lak::optional<std::thread> asset_loader;
 
 bool init_game_state()
@@ -318,9 +732,28 @@ in vec4 vColor;
 in vec3 vNormal;
 in vec2 vTexCoord;
 
-uniform mat4 projview;
-uniform mat4 invprojview;
-uniform mat4 model;
+#define MAX_LIGHTS 6
+struct light {
+	vec3 position;
+	vec4 color;
+};
+
+layout(std140) uniform FrameData {
+	mat4 projview;
+	mat4 invprojview;
+	vec4 ambient;
+	vec4 diffuse;
+	vec4 specular;
+	float shininess;
+	int lightCount;
+	light lights[MAX_LIGHTS];
+};
+
+layout(std140) uniform ObjectData {
+	mat4 model;
+	// fColor holds the ambient and diffuse lighting baked at load time.
+	int bakedLighting;
+};
 
 out vec4 fColor;
 out vec3 fNormal;
@@ -355,18 +788,28 @@ smooth in vec2 fTexCoord;
 
 uniform sampler2D albedo;
 
-uniform vec4 ambient;
-uniform vec4 diffuse;
-uniform vec4 specular;
-uniform float shininess;
-
 #define MAX_LIGHTS 6
 struct light {
 	vec3 position;
 	vec4 color;
 };
-uniform int lightCount;
-uniform light lights[MAX_LIGHTS];
+
+layout(std140) uniform FrameData {
+	mat4 projview;
+	mat4 invprojview;
+	vec4 ambient;
+	vec4 diffuse;
+	vec4 specular;
+	float shininess;
+	int lightCount;
+	light lights[MAX_LIGHTS];
+};
+
+layout(std140) uniform ObjectData {
+	mat4 model;
+	// fColor holds the ambient and diffuse lighting baked at load time.
+	int bakedLighting;
+};
 
 out vec4 pColor;
 
@@ -376,26 +819,35 @@ void main()
 	vec3 viewDir = normalize(fEye - fPosition);
 	vec4 texColor = texture(albedo, fTexCoord); // * fColor;
 
-	pColor = ambient * mix(fColor, texColor, texColor.w);
+	if (bakedLighting != 0)
+		pColor = texColor * fColor;
+	else
+		pColor = ambient * mix(fColor, texColor, texColor.w);
 
 	for(int i = 0; i < lightCount && i < MAX_LIGHTS; i++)
 	{
 		vec3 lightDir = normalize(lights[i].position - fPosition);
-		float dNL = max(dot(normal, lightDir), 0.0f);
-		vec4 color = diffuse;
-		color = diffuse * texColor;
-		vec4 lambert = color * lights[i].color * dNL;
+
+		if (bakedLighting == 0)
+		{
+			float dNL = max(dot(normal, lightDir), 0.0f);
+			vec4 color = diffuse;
+			color = diffuse * texColor;
+			vec4 lambert = color * lights[i].color * dNL;
+			pColor += lambert;
+		}
 
 		vec3 halfVec = normalize(lightDir + viewDir);
 		float dNH = max(dot(normal, halfVec), 0.0f);
 		vec4 phong = specular * lights[i].color * pow(dNH, shininess);
-		pColor += lambert + phong;
+		pColor += phong;
 	}
 })"_fragment_shader.UNWRAP();
 
 			ud.scene.shader =
 			  lak::opengl::program::create_shared(vshader, fshader).UNWRAP();
 			ud.scene.shader->use().UNWRAP();
+			bind_uniform_blocks();
 		}
 
 		ud.scene.world      = lak::shared_ptr<reference_frame>::make();
@@ -413,7 +865,7 @@ void main()
 			  load_opengl_texture(ball_texture));
 
 			ud.scene.ball = model{
-			  .frame = ud.scene.player->add_child(),
+			  .frame = ud.scene.player->add_child().get(),
 			  .mesh =
 			    make_mesh(ball_vertices, GL_TRIANGLES, ud.scene.shader, albedo),
 			};
@@ -423,25 +875,12 @@ void main()
 			auto albedo = lak::shared_ptr<lak::opengl::texture>::make(
 			  load_opengl_texture(cube_texture));
 
-			auto obj_part =
-			  make_mesh(cube_vertices, GL_TRIANGLES, ud.scene.shader, albedo);
-
-			ud.scene.blocks.clear();
-			ud.scene.blocks.reserve(map_texture.size().x * map_texture.size().y);
-			for (size_t x = 0; x < map_texture.size().x; x++)
+			ud.scene.static_chunks.clear();
+			for (const auto &chunk : static_chunks)
 			{
-				for (size_t y = 0; y < map_texture.size().y; y++)
-				{
-					if (map_texture[{x, y}].r > 0)
-					{
-						auto &block = ud.scene.blocks.push_back(model{
-						  .frame = lak::shared_ptr<reference_frame>::make(),
-						  .mesh  = obj_part,
-						});
-
-						block.frame->translation.value = {x * 2.0f, y * -2.0f, -2.0f};
-					}
-				}
+				if (chunk.vertices.empty()) continue;
+				ud.scene.static_chunks.push_back(make_mesh(
+				  chunk.vertices, GL_TRIANGLES, ud.scene.shader, albedo));
 			}
 		}
 
@@ -449,75 +888,45 @@ void main()
 			auto albedo = lak::shared_ptr<lak::opengl::texture>::make(
 			  load_opengl_texture(coin_texture));
 
-			auto obj_part =
+			ud.scene.coin_mesh =
 			  make_mesh(coin_vertices, GL_TRIANGLES, ud.scene.shader, albedo);
-
-			ud.scene.coins.clear();
-			ud.scene.coins.reserve(map_texture.size().x * map_texture.size().y);
-			for (size_t x = 0; x < map_texture.size().x; x++)
-			{
-				for (size_t y = 0; y < map_texture.size().y; y++)
-				{
-					if (map_texture[{x, y}].g > 0)
-					{
-						auto &coin = ud.scene.coins.push_back(model{
-						  .frame = lak::shared_ptr<reference_frame>::make(),
-						  .mesh  = obj_part,
-						});
-
-						coin.frame->translation.value   = {x * 2.0f, y * -2.0f, 0.0f};
-						coin.frame->rotation.velocity.z = 1.0f;
-					}
-				}
-			}
-			ud.scene.coins_reset = ud.scene.coins;
 		}
 
+		build_scene_entities(ud.scene, map_tiles);
+
+		if (startup_save)
 		{
-			ud.scene.lights.clear();
-			for (size_t x = 0; x < map_texture.size().x; x++)
-			{
-				for (size_t y = 0; y < map_texture.size().y; y++)
-				{
-					if (map_texture[{x, y}].b > 0)
-					{
-						auto &li = ud.scene.lights.push_back(light{
-						  .frame  = lak::shared_ptr<reference_frame>::make(),
-						  .colour = {0.5f, 0.5f, 0.5f, 1.0f},
-						});
-
-						li.frame->translation.value = {x * 2.0f, y * -2.0f, 2.0f};
-					}
-				}
-			}
+			if (apply_save(ud.scene, map_tiles, *startup_save))
+				startup_state = state_t(startup_save->game_state);
+			startup_save.reset();
+		}
 
-			size_t lightCount = std::min<size_t>(6U, ud.scene.lights.size());
-			ud.scene.shader->assert_set_uniform("lightCount",
-			                                    lak::as_bytes(&lightCount));
+		{
+			auto &frame = ud.scene.frame_data;
+			frame       = {};
 
-			for (size_t i = 0; i < lightCount; i++)
+			const size_t light_count =
+			  std::min<size_t>(max_lights, ud.scene.lights.size());
+			frame.light_count = int32_t(light_count);
+			for (size_t i = 0; i < light_count; i++)
 			{
-				auto lightname = "lights["_str + (char)('0' + i) + "]"_str;
-				ud.scene.shader->assert_set_uniform(
-				  (lightname + ".position").c_str(),
-				  lak::as_bytes(&ud.scene.lights[i].frame->translation.value));
-				ud.scene.shader->assert_set_uniform(
-				  (lightname + ".color").c_str(),
-				  lak::as_bytes(&ud.scene.lights[i].colour));
+				frame.lights[i] = std140_light{
+				  .position = glm::vec4(ud.scene.lights[i].frame->translation.value,
+				                        1.0f),
+				  .colour   = ud.scene.lights[i].colour,
+				};
 			}
 
-			auto temp_vec = glm::vec4(0.1f, 0.1f, 0.1f, 1.0f);
-			ud.scene.shader->assert_set_uniform("ambient", lak::as_bytes(&temp_vec));
-			temp_vec = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
-			ud.scene.shader->assert_set_uniform("diffuse", lak::as_bytes(&temp_vec));
-			temp_vec = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
-			ud.scene.shader->assert_set_uniform("specular",
-			                                    lak::as_bytes(&temp_vec));
-			float shininess = 100.0f;
-			ud.scene.shader->assert_set_uniform("shininess",
-			                                    lak::as_bytes(&shininess));
-			auto temp_mat = glm::mat4(1.0f);
-			ud.scene.shader->assert_set_uniform("model", lak::as_bytes(&temp_mat));
+			frame.ambient   = ambient_colour;
+			frame.diffuse   = diffuse_colour;
+			frame.specular  = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
+			frame.shininess = 100.0f;
+
+			ud.scene.frame_block =
+			  lak::shared_ptr<uniform_block<frame_uniforms>>::make();
+			ud.scene.object_ring =
+			  lak::shared_ptr<uniform_ring_buffer<object_uniforms>>::make(
+			    ud.scene.static_chunks.size() + 1 + ud.scene.coins_reset.size());
 		}
 
 		return true;
@@ -531,10 +940,228 @@ void main()
 	return false;
 }
 
+void apply_input(scene &scene, const player_input &input)
+{
+	scene.player->rotation.velocity.z        = input.turn * 2.0f;
+	scene.ball.frame->rotation.acceleration.x = input.roll * 3.0f;
+}
+
+state_t simulate(scene &scene, float frame_time)
+{
+	state_t result = RUNNING;
+
+	scene.player->translation.velocity.x =
+	  std::sin(scene.player->rotation.value.z) *
+	  scene.ball.frame->rotation.velocity.x;
+
+	scene.player->translation.velocity.y =
+	  -std::cos(scene.player->rotation.value.z) *
+	  scene.ball.frame->rotation.velocity.x;
+
+	scene.world->update(frame_time);
+	scene.player->update(frame_time);
+	scene.cameraBoom->update(frame_time);
+	scene.camera.frame->update(frame_time);
+
+	for (auto &light : scene.lights) light.frame->update(frame_time);
+	for (auto *block : scene.blocks) block->update(frame_time);
+	for (auto *coin : scene.coins) coin->update(frame_time);
+
+	scene.ball.frame->update(frame_time);
+
+	auto player_world_pos = scene.player->total_translation();
+	for (size_t i = 0; i < scene.coins.size();)
+	{
+		glm::vec3 dist = scene.coins[i]->total_translation() - player_world_pos;
+		float dst = std::sqrt((dist.x * dist.x) + (dist.y * dist.y));
+
+		if (dst < 1.0f)
+		{
+			// draw order doesn't matter, swap and pop so the remaining coins
+			// don't get shifted down.
+			if (i + 1 != scene.coins.size())
+				std::swap(scene.coins[i], scene.coins.back());
+			scene.coins.pop_back();
+		}
+		else
+			++i;
+	}
+	if (scene.coins.empty()) result = WIN;
+
+	bool onTrack = false;
+	for (const auto *block : scene.blocks)
+	{
+		glm::vec3 dist = block->total_translation() - player_world_pos;
+		onTrack |= std::abs(dist.x) <= 1.0f && std::abs(dist.y) <= 1.0f;
+	}
+	if (!onTrack) result = LOSS;
+
+	return result;
+}
+
+// Reuses the existing coin storage so restarting doesn't reallocate.
+void restart(scene &scene)
+{
+	scene.player->translation.value     = glm::vec3(0);
+	scene.player->translation.velocity  = glm::vec3(0);
+	scene.player->rotation.value        = glm::vec3(0);
+	scene.player->rotation.velocity     = glm::vec3(0);
+	scene.ball.frame->rotation.value    = glm::vec3(0);
+	scene.ball.frame->rotation.velocity = glm::vec3(0);
+	scene.coins.clear();
+	for (auto *coin : scene.coins_reset) scene.coins.push_back(coin);
+}
+
+void take_snapshot(scene &scene, scene_snapshot &snapshot)
+{
+	snapshot.view = scene.camera.update_view();
+	snapshot.ball = scene.ball.frame->get_transform();
+
+	snapshot.coins.resize(scene.coins.size());
+	for (size_t i = 0; i < scene.coins.size(); i++)
+		snapshot.coins[i] = scene.coins[i]->get_transform();
+}
+
+// Runs on the pipeline worker thread, the window thread doesn't touch the
+// scene between pipeline.kick() and pipeline.wait().
+void pipeline_step(scene_snapshot &snapshot)
+{
+	alloc_phase_scope phase(ALLOC_SIM);
+	if (state == RUNNING) state = simulate(ud.scene, pipeline_frame_time);
+	take_snapshot(ud.scene, snapshot);
+}
+
+void set_pipelined(bool pipelined)
+{
+	if (pipelined == pipeline.running()) return;
+	ud.pipelined = pipelined;
+	if (pipelined)
+	{
+		pipeline.start(&pipeline_step);
+		// prime the front buffer without advancing the simulation.
+		pipeline_frame_time = 0.0f;
+		pipeline.kick();
+		pipeline.wait();
+	}
+	else
+	{
+		pipeline.stop();
+	}
+}
+
+// Uncaps the frame rate so events are polled right before every tick, and
+// turns off the pipeline since it delays every tick by a frame.
+void set_low_latency(bool low_latency)
+{
+	ud.low_latency                = low_latency;
+	basic_window_target_framerate = low_latency ? 0 : 60;
+	if (low_latency) set_pipelined(false);
+}
+
+void view_latency_histogram(const char *label, const latency_histogram &hist)
+{
+	float values[latency_histogram::bucket_count + 1];
+	for (size_t i = 0; i < std::size(values); i++)
+		values[i] = float(hist.buckets[i]);
+
+	ImGui::Text("%s: mean %.2fms, p50 %.2fms, p95 %.2fms, max %.2fms",
+	            label,
+	            hist.mean() * 1000.0,
+	            hist.percentile(0.5) * 1000.0,
+	            hist.percentile(0.95) * 1000.0,
+	            hist.max_seconds * 1000.0);
+	ImGui::PushID(label);
+	ImGui::PlotHistogram("",
+	                     values,
+	                     int(std::size(values)),
+	                     0,
+	                     nullptr,
+	                     0.0f,
+	                     FLT_MAX,
+	                     ImVec2(0, 60));
+	ImGui::PopID();
+	ImGui::Text("0ms - %.0fms", latency_histogram::range_seconds * 1000.0);
+}
+
+void render_scene(lak::window &window, const scene_snapshot &snapshot)
+{
+	{
+		auto &frame = ud.scene.frame_data;
+		const auto projview =
+		  ud.scene.camera.update_projection(window) * snapshot.view;
+		if (projview != frame.projview)
+		{
+			frame.projview    = projview;
+			frame.invprojview = glm::transpose(glm::inverse(projview));
+		}
+		ud.scene.frame_block->update(frame);
+		ud.scene.frame_block->bind(frame_uniforms_binding);
+	}
+
+	auto &objects = *ud.scene.object_ring;
+	{
+		const size_t count =
+		  ud.scene.static_chunks.size() + 1 + snapshot.coins.size();
+		objects.map(count);
+		size_t index = 0;
+		for (size_t i = 0; i < ud.scene.static_chunks.size(); i++)
+			objects[index++] = {.model = glm::mat4(1.0f), .baked_lighting = 1};
+		objects[index++] = {.model = snapshot.ball, .baked_lighting = 0};
+		for (const auto &it : snapshot.coins)
+			objects[index++] = {.model = it, .baked_lighting = 0};
+		objects.unmap();
+	}
+
+	lak::opengl::enable_if(GL_BLEND, true).UNWRAP();
+	lak::opengl::call_checked(glBlendEquationSeparate, GL_FUNC_ADD, GL_FUNC_ADD)
+	  .UNWRAP();
+	lak::opengl::call_checked(glBlendFuncSeparate,
+	                          GL_SRC_ALPHA,
+	                          GL_ONE_MINUS_SRC_ALPHA,
+	                          GL_SRC_ALPHA,
+	                          GL_ONE_MINUS_SRC_ALPHA)
+	  .UNWRAP();
+
+	lak::opengl::enable_if(GL_DEPTH_TEST, true).UNWRAP();
+	lak::opengl::call_checked(glDepthFunc, GL_LESS).UNWRAP();
+	lak::opengl::call_checked(glDepthRange, GLdouble(0.0), GLdouble(1.0))
+	  .UNWRAP();
+
+	lak::opengl::enable_if(GL_CULL_FACE, false).UNWRAP();
+
+	lak::opengl::enable_if(GL_SCISSOR_TEST, false).UNWRAP();
+
+	lak::opengl::call_checked(glViewport,
+	                          static_cast<GLint>(0),
+	                          static_cast<GLint>(0),
+	                          static_cast<GLsizei>(window.drawable_size().x),
+	                          static_cast<GLsizei>(window.drawable_size().y))
+	  .UNWRAP();
+
+	// same order the object data was written in.
+	size_t index = 0;
+	for (const auto &chunk : ud.scene.static_chunks)
+	{
+		objects.bind(object_uniforms_binding, index++);
+		chunk->draw();
+	}
+	objects.bind(object_uniforms_binding, index++);
+	ud.scene.ball.mesh->draw();
+	for (size_t i = 0; i < snapshot.coins.size(); i++)
+	{
+		objects.bind(object_uniforms_binding, index++);
+		ud.scene.coin_mesh->draw();
+	}
+
+	objects.end_frame();
+}
+
 void basic_window_init(lak::window &window) { LAK_UNUSED(window); }
 
 void basic_window_handle_event(lak::window *window, lak::event &event)
 {
+	alloc_phase_scope phase(ALLOC_EVENTS);
+
 	switch (event.type)
 	{
 		case lak::event_type::window_closed:
@@ -550,36 +1177,44 @@ void basic_window_handle_event(lak::window *window, lak::event &event)
 			break;
 
 		case lak::event_type::key_down:
+		{
+			// the OS timestamp isn't available through lak::event, dispatch time
+			// is the earliest point the event can be stamped.
+			const uint64_t now = lak::performance_counter();
 			switch (event.key().scancode)
 			{
 				case 79: // right
-					ud.scene.player->rotation.velocity.z = -2;
+					ud.input_events.push({now, INPUT_TURN, -1});
 					break;
 				case 80: // left
-					ud.scene.player->rotation.velocity.z = 2;
+					ud.input_events.push({now, INPUT_TURN, 1});
 					break;
 				case 81: // down
-					ud.scene.ball.frame->rotation.acceleration.x = -3;
+					ud.input_events.push({now, INPUT_ROLL, -1});
 					break;
 				case 82: // up
-					ud.scene.ball.frame->rotation.acceleration.x = 3;
+					ud.input_events.push({now, INPUT_ROLL, 1});
 					break;
 			}
-			break;
+		}
+		break;
 
 		case lak::event_type::key_up:
+		{
+			const uint64_t now = lak::performance_counter();
 			switch (event.key().scancode)
 			{
 				case 79: // right
 				case 80: // left
-					ud.scene.player->rotation.velocity.z = 0;
+					ud.input_events.push({now, INPUT_TURN, 0});
 					break;
 				case 81: // down
 				case 82: // up
-					ud.scene.ball.frame->rotation.acceleration.x = 0;
+					ud.input_events.push({now, INPUT_ROLL, 0});
 					break;
 			}
-			break;
+		}
+		break;
 
 		default:
 			break;
@@ -590,6 +1225,55 @@ void basic_window_loop(lak::window &window, uint64_t counter_delta)
 {
 	const float frame_time = (float)counter_delta / lak::performance_frequency();
 
+	// the previous tick must be finished before the scene or state are touched.
+	if (pipeline.running()) pipeline.wait();
+
+	// this is the first point after the previous frame was presented.
+	const uint64_t tick_time = lak::performance_counter();
+	ud.latency.pending_present.frame_presented(
+	  tick_time, lak::performance_frequency(), ud.latency.to_present);
+
+	// every event received so far takes effect in this tick, which reaches the
+	// screen at the next present, or the one after when pipelined.
+	const bool measure_input = state == RUNNING;
+	ud.input_events.apply(
+	  tick_time,
+	  ud.input,
+	  [&](const input_event &event)
+	  {
+		  if (!measure_input) return;
+		  ud.latency.to_sim.record(double(tick_time - event.timestamp) /
+		                           lak::performance_frequency());
+		  ud.latency.pending_present.add(event.timestamp, ud.pipelined ? 2U : 1U);
+	  });
+
+	allocs.begin_frame();
+	if (alloc_test && allocs.last_frame_running &&
+	    ++alloc_test_frame > alloc_test_warmup)
+	{
+		if (allocs.last_frame_allocations > 0)
+		{
+			std::printf("alloc test failed: RUNNING frame %zu allocated\n",
+			            alloc_test_frame);
+			for (size_t i = 0; i < ALLOC_PHASE_COUNT; i++)
+				std::printf("  %s: %" PRIu64 " allocations, %" PRIu64 " bytes\n",
+				            alloc_phase_name(alloc_phase(i)),
+				            allocs.last_frame[i].allocations,
+				            allocs.last_frame[i].bytes);
+			exit_code    = EXIT_FAILURE;
+			game_running = false;
+		}
+		else if (alloc_test_frame >= alloc_test_frames)
+		{
+			std::printf("alloc test passed: %zu RUNNING frames without "
+			            "allocating\n",
+			            alloc_test_frame - alloc_test_warmup);
+			game_running = false;
+		}
+	}
+
+	alloc_phase_scope ui_phase(ALLOC_UI);
+
 	ImGuiIO &io = ImGui::GetIO();
 
 	bool mainOpen = true;
@@ -613,145 +1297,180 @@ void basic_window_loop(lak::window &window, uint64_t counter_delta)
 		case state_t::LOADING:
 		{
 			ImGui::Text("Loading...");
-			if (init_game_state()) state = state_t::RUNNING;
+			if (init_game_state()) state = startup_state;
 			ImGui::End();
+			allocs.end_frame(state == RUNNING);
 			return;
 		}
 		break;
 
 		case state_t::RUNNING:
 		{
-			auto &scene = ud.scene;
-
-			scene.player->translation.velocity.x =
-			  std::sin(scene.player->rotation.value.z) *
-			  scene.ball.frame->rotation.velocity.x;
+			alloc_phase_scope phase(ALLOC_SIM);
+			apply_input(ud.scene, ud.input);
+			if (!ud.pipelined) state = simulate(ud.scene, frame_time);
 
-			scene.player->translation.velocity.y =
-			  -std::cos(scene.player->rotation.value.z) *
-			  scene.ball.frame->rotation.velocity.x;
-
-			scene.world->update(frame_time);
-			scene.player->update(frame_time);
-			scene.cameraBoom->update(frame_time);
-			scene.camera.frame->update(frame_time);
-
-			for (auto &light : scene.lights) light.frame->update(frame_time);
-			for (auto &block : scene.blocks) block.frame->update(frame_time);
-			for (auto &coin : scene.coins) coin.frame->update(frame_time);
-
-			scene.ball.frame->update(frame_time);
+			ImGui::Text("Score");
+			ImGui::Text("%zu/%zu",
+			            ud.scene.coins_reset.size() - ud.scene.coins.size(),
+			            ud.scene.coins_reset.size());
 
-			auto player_world_pos = scene.player->total_translation();
-			for (auto it = scene.coins.begin(); it != scene.coins.end();)
+			if (ImGui::Button("save"))
 			{
-				glm::vec3 dist = it->frame->total_translation() - player_world_pos;
-				float dst      = std::sqrt((dist.x * dist.x) + (dist.y * dist.y));
-
-				if (dst < 1.0f)
-					it = scene.coins.erase(it);
-				else
-					++it;
+				const uint64_t start = lak::performance_counter();
+				save_level(quicksave_path, make_save(ud.scene, map_tiles, state));
+				last_save_load_seconds =
+				  double(lak::performance_counter() - start) /
+				  lak::performance_frequency();
 			}
-			if (ud.scene.coins.empty()) state = WIN;
-
-			bool onTrack = false;
-			for (auto &block : scene.blocks)
+			ImGui::SameLine();
+			if (ImGui::Button("load"))
 			{
-				glm::vec3 dist = block.frame->total_translation() - player_world_pos;
-				onTrack |= std::abs(dist.x) <= 1.0f && std::abs(dist.y) <= 1.0f;
+				const uint64_t start = lak::performance_counter();
+				if (auto save = load_level(quicksave_path);
+				    save && apply_save(ud.scene, map_tiles, *save))
+					state = state_t(save->game_state);
+				last_save_load_seconds =
+				  double(lak::performance_counter() - start) /
+				  lak::performance_frequency();
 			}
-			if (!onTrack) state = LOSS;
-
-			ImGui::Text("Score");
-			ImGui::Text("%zu/%zu",
-			            ud.scene.coins_reset.size() - ud.scene.coins.size(),
-			            ud.scene.coins_reset.size());
+			ImGui::SameLine();
+			ImGui::Text("%.3fms", last_save_load_seconds * 1000.0);
 		}
 		break;
 
 		case state_t::WIN:
 		{
-			auto &scene = ud.scene;
-
 			ImGui::Text("YOUR'RE WINNER !");
 			if (ImGui::Button("restart"))
 			{
-				scene.player->translation.value     = glm::vec3(0);
-				scene.player->translation.velocity  = glm::vec3(0);
-				scene.player->rotation.value        = glm::vec3(0);
-				scene.player->rotation.velocity     = glm::vec3(0);
-				scene.ball.frame->rotation.value    = glm::vec3(0);
-				scene.ball.frame->rotation.velocity = glm::vec3(0);
-				scene.coins                         = scene.coins_reset;
-				state                               = RUNNING;
+				restart(ud.scene);
+				state = RUNNING;
 			}
 		}
 		break;
 
 		case state_t::LOSS:
 		{
-			auto &scene = ud.scene;
-
 			ImGui::Text("you fell off :(");
 			if (ImGui::Button("try again"))
 			{
-				scene.player->translation.value     = glm::vec3(0);
-				scene.player->translation.velocity  = glm::vec3(0);
-				scene.player->rotation.value        = glm::vec3(0);
-				scene.player->rotation.velocity     = glm::vec3(0);
-				scene.ball.frame->rotation.value    = glm::vec3(0);
-				scene.ball.frame->rotation.velocity = glm::vec3(0);
-				scene.coins                         = scene.coins_reset;
-				state                               = RUNNING;
+				restart(ud.scene);
+				state = RUNNING;
 			}
 		}
 		break;
 	}
 
+	const bool running_at_end      = state == RUNNING;
+	const scene_snapshot *snapshot = &ud.snapshot;
+	if (ud.pipelined)
 	{
-		auto projview    = ud.scene.camera.update_projview(window);
-		auto invprojview = glm::transpose(glm::inverse(projview));
-		ud.scene.shader->assert_set_uniform("projview", lak::as_bytes(&projview));
-		ud.scene.shader->assert_set_uniform("invprojview",
-		                                    lak::as_bytes(&invprojview));
+		pipeline_frame_time = frame_time;
+		pipeline.kick();
+		snapshot = &pipeline.front();
+	}
+	else
+	{
+		alloc_phase_scope phase(ALLOC_SIM);
+		take_snapshot(ud.scene, ud.snapshot);
 	}
 
-	lak::opengl::enable_if(GL_BLEND, true).UNWRAP();
-	lak::opengl::call_checked(glBlendEquationSeparate, GL_FUNC_ADD, GL_FUNC_ADD)
-	  .UNWRAP();
-	lak::opengl::call_checked(glBlendFuncSeparate,
-	                          GL_SRC_ALPHA,
-	                          GL_ONE_MINUS_SRC_ALPHA,
-	                          GL_SRC_ALPHA,
-	                          GL_ONE_MINUS_SRC_ALPHA)
-	  .UNWRAP();
-
-	lak::opengl::enable_if(GL_DEPTH_TEST, true).UNWRAP();
-	lak::opengl::call_checked(glDepthFunc, GL_LESS).UNWRAP();
-	lak::opengl::call_checked(glDepthRange, GLdouble(0.0), GLdouble(1.0))
-	  .UNWRAP();
+	const uint64_t render_start = lak::performance_counter();
+	{
+		alloc_phase_scope phase(ALLOC_RENDER);
+		render_scene(window, *snapshot);
+	}
+	const double render_seconds =
+	  double(lak::performance_counter() - render_start) /
+	  lak::performance_frequency();
 
-	lak::opengl::enable_if(GL_CULL_FACE, false).UNWRAP();
+	if (ImGui::TreeNode("pipeline"))
+	{
+		bool pipelined = ud.pipelined;
+		if (ImGui::Checkbox("pipelined", &pipelined))
+		{
+			set_pipelined(pipelined);
+			if (pipelined && ud.low_latency) set_low_latency(false);
+		}
+		if (ud.pipelined)
+		{
+			const double sim_seconds  = pipeline.sim_seconds();
+			const double wait_seconds = pipeline.wait_seconds();
+			ImGui::Text("sim: %.3fms", sim_seconds * 1000.0);
+			ImGui::Text("render: %.3fms", render_seconds * 1000.0);
+			ImGui::Text("waited: %.3fms", wait_seconds * 1000.0);
+			ImGui::Text("overlap: %.3fms",
+			            std::max(sim_seconds - wait_seconds, 0.0) * 1000.0);
+			ImGui::Text("added latency: %.3fms", frame_time * 1000.0);
+		}
+		else
+		{
+			ImGui::Text("render: %.3fms", render_seconds * 1000.0);
+		}
+		ImGui::TreePop();
+	}
 
-	lak::opengl::enable_if(GL_SCISSOR_TEST, false).UNWRAP();
+	if (ImGui::TreeNode("input latency"))
+	{
+		bool low_latency = ud.low_latency;
+		if (ImGui::Checkbox("low latency", &low_latency))
+			set_low_latency(low_latency);
+		view_latency_histogram("dispatch to sim", ud.latency.to_sim);
+		view_latency_histogram("dispatch to present", ud.latency.to_present);
+		// events are only stamped when lak dispatches them, which happens at
+		// the start of a frame, so the wait in the OS queue is missing.
+		const double queue_bound =
+		  basic_window_target_framerate > 0
+		    ? 1.0 / double(basic_window_target_framerate)
+		    : double(frame_time);
+		ImGui::TextWrapped(
+		  "Not measured: time spent in the OS event queue before dispatch, up "
+		  "to %.1fms at the current frame rate.",
+		  queue_bound * 1000.0);
+		if (ImGui::Button("reset"))
+		{
+			ud.latency.to_sim.reset();
+			ud.latency.to_present.reset();
+		}
+		ImGui::TreePop();
+	}
 
-	lak::opengl::call_checked(glViewport,
-	                          static_cast<GLint>(0),
-	                          static_cast<GLint>(0),
-	                          static_cast<GLsizei>(window.drawable_size().x),
-	                          static_cast<GLsizei>(window.drawable_size().y))
-	  .UNWRAP();
+	if (ImGui::TreeNode("uniforms"))
+	{
+		ImGui::Text("frame block uploads: %" PRIu64,
+		            ud.scene.frame_block->uploads());
+		ImGui::Text("object ring: %zu entries, %" PRIu64 " stalls",
+		            ud.scene.object_ring->capacity(),
+		            ud.scene.object_ring->stalls());
+		ImGui::TreePop();
+	}
 
-	ud.scene.ball.draw();
-	for (auto &it : ud.scene.blocks) it.draw();
-	for (auto &it : ud.scene.coins) it.draw();
+	if (ImGui::TreeNode("allocations"))
+	{
+		for (size_t i = 0; i < ALLOC_PHASE_COUNT; i++)
+		{
+			const auto &counts = allocs.last_frame[i];
+			ImGui::Text("%s: %" PRIu64 " allocs, %" PRIu64 " frees, %" PRIu64
+			            " bytes",
+			            alloc_phase_name(alloc_phase(i)),
+			            counts.allocations,
+			            counts.frees,
+			            counts.bytes);
+		}
+		ImGui::Text("worst RUNNING frame: %" PRIu64 " allocs",
+		            allocs.worst_running_frame);
+		ImGui::TreePop();
+	}
 
 	ImGui::End();
+
+	allocs.end_frame(running_at_end);
 }
 
 void basic_window_quit(lak::window &window)
 {
 	LAK_UNUSED(window);
+	set_pipelined(false);
 	ud = {};
 }
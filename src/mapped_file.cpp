@@ -0,0 +1,113 @@
+#include "mapped_file.hpp"
+
+#include <utility>
+
+#ifdef _WIN32
+#	ifndef WIN32_LEAN_AND_MEAN
+#		define WIN32_LEAN_AND_MEAN
+#	endif
+#	ifndef NOMINMAX
+#		define NOMINMAX
+#	endif
+#	include <windows.h>
+#else
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#endif
+
+lak::optional<mapped_file> mapped_file::open(const lak::fs::path &path)
+{
+	mapped_file result;
+
+#ifdef _WIN32
+	HANDLE file = CreateFileW(path.c_str(),
+	                          GENERIC_READ,
+	                          FILE_SHARE_READ,
+	                          nullptr,
+	                          OPEN_EXISTING,
+	                          FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+	                          nullptr);
+	if (file == INVALID_HANDLE_VALUE) return lak::nullopt;
+	result._file = file;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size)) return lak::nullopt;
+	result._size = static_cast<size_t>(size.QuadPart);
+	if (result._size == 0) return lak::optional<mapped_file>(std::move(result));
+
+	HANDLE mapping =
+	  CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mapping) return lak::nullopt;
+	result._mapping = mapping;
+
+	result._data =
+	  static_cast<const char *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	if (!result._data) return lak::nullopt;
+#else
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) return lak::nullopt;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0)
+	{
+		::close(fd);
+		return lak::nullopt;
+	}
+	result._size = static_cast<size_t>(st.st_size);
+	if (result._size == 0)
+	{
+		::close(fd);
+		return lak::optional<mapped_file>(std::move(result));
+	}
+
+	void *data = mmap(nullptr, result._size, PROT_READ, MAP_PRIVATE, fd, 0);
+	// the mapping keeps the file alive, we don't need the descriptor anymore.
+	::close(fd);
+	if (data == MAP_FAILED) return lak::nullopt;
+	madvise(data, result._size, MADV_WILLNEED);
+	result._data = static_cast<const char *>(data);
+#endif
+
+	return lak::optional<mapped_file>(std::move(result));
+}
+
+mapped_file::mapped_file(mapped_file &&other)
+: _data(std::exchange(other._data, nullptr)),
+  _size(std::exchange(other._size, 0U))
+#ifdef _WIN32
+  ,
+  _file(std::exchange(other._file, nullptr)),
+  _mapping(std::exchange(other._mapping, nullptr))
+#endif
+{
+}
+
+mapped_file &mapped_file::operator=(mapped_file &&other)
+{
+	std::swap(_data, other._data);
+	std::swap(_size, other._size);
+#ifdef _WIN32
+	std::swap(_file, other._file);
+	std::swap(_mapping, other._mapping);
+#endif
+	return *this;
+}
+
+mapped_file::~mapped_file() { close(); }
+
+void mapped_file::close()
+{
+#ifdef _WIN32
+	if (_data) UnmapViewOfFile(_data);
+	if (_mapping) CloseHandle(_mapping);
+	if (_file) CloseHandle(_file);
+	_file    = nullptr;
+	_mapping = nullptr;
+#else
+	if (_data) munmap(const_cast<char *>(_data), _size);
+#endif
+	_data = nullptr;
+	_size = 0;
+}
@@ -0,0 +1,36 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <lak/file.hpp>
+#include <lak/optional.hpp>
+
+#include <cstddef>
+#include <string_view>
+
+// Read-only memory mapping of an entire file.
+struct mapped_file
+{
+	static lak::optional<mapped_file> open(const lak::fs::path &path);
+
+	mapped_file(mapped_file &&other);
+	mapped_file &operator=(mapped_file &&other);
+	~mapped_file();
+
+	const char *data() const { return _data; }
+	size_t size() const { return _size; }
+	std::string_view view() const { return {_data, _size}; }
+
+private:
+	mapped_file() = default;
+
+	void close();
+
+	const char *_data = nullptr;
+	size_t _size      = 0;
+#ifdef _WIN32
+	void *_file    = nullptr;
+	void *_mapping = nullptr;
+#endif
+};
+
+#endif
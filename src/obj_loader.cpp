@@ -0,0 +1,359 @@
+#include "obj_loader.hpp"
+
+#include "mapped_file.hpp"
+#include "parallel.hpp"
+
+#include <lak/debug.hpp>
+
+#include <atomic>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+// Minimum number of bytes per line range, smaller files aren't worth the
+// thread overhead.
+static constexpr size_t obj_min_chunk_size = 256U * 1024U;
+
+struct obj_chunk
+{
+	std::string_view text;
+
+	// number of each element in this chunk, then turned into the offset of this
+	// chunk's first element by the prefix sum.
+	size_t positions  = 0;
+	size_t tex_coords = 0;
+	size_t normals    = 0;
+	size_t vertices   = 0;
+};
+
+struct obj_coords
+{
+	lak::array<glm::vec4> positions;
+	lak::array<glm::vec2> tex_coords;
+	lak::array<glm::vec3> normals;
+};
+
+template<typename FUNC>
+static bool for_each_line(std::string_view text, FUNC &&func)
+{
+	while (!text.empty())
+	{
+		const size_t end = text.find('\n');
+		auto line        = text.substr(0, end);
+		text.remove_prefix(end == std::string_view::npos ? text.size() : end + 1);
+		if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+		if (!func(line)) return false;
+	}
+	return true;
+}
+
+static std::string_view next_token(std::string_view &line)
+{
+	const size_t begin = line.find_first_not_of(" \t");
+	if (begin == std::string_view::npos)
+	{
+		line = {};
+		return {};
+	}
+	line.remove_prefix(begin);
+	auto token = line.substr(0, line.find_first_of(" \t"));
+	line.remove_prefix(token.size());
+	return token;
+}
+
+template<typename T>
+static bool parse_number(std::string_view token, T &out)
+{
+	if (!token.empty() && token.front() == '+') token.remove_prefix(1);
+	const char *end = token.data() + token.size();
+	auto [ptr, ec]  = std::from_chars(token.data(), end, out);
+	return ec == std::errc{} && ptr == end;
+}
+
+// Floating point std::from_chars is missing from older libc++ (including
+// Apple's), so floats go through strtof on a null terminated copy.
+static bool parse_number(std::string_view token, float &out)
+{
+	char buffer[64];
+	if (token.empty() || token.size() >= sizeof(buffer)) return false;
+	std::memcpy(buffer, token.data(), token.size());
+	buffer[token.size()] = '\0';
+
+	char *end = nullptr;
+	out       = std::strtof(buffer, &end);
+	return end == buffer + token.size();
+}
+
+// Reads up to N floats from the rest of the line, at least `required` of
+// which must be present.
+template<size_t N>
+static bool parse_floats(std::string_view line,
+                         size_t required,
+                         float (&out)[N])
+{
+	for (size_t i = 0; i < N; ++i)
+	{
+		auto token = next_token(line);
+		if (token.empty()) return i >= required;
+		if (!parse_number(token, out[i])) return false;
+	}
+	return true;
+}
+
+// Converts a 1-based (or negative relative) obj index into a 0-based index.
+static bool resolve_index(std::string_view token,
+                          size_t defined,
+                          size_t total,
+                          size_t &out)
+{
+	long long index;
+	if (!parse_number(token, index) || index == 0) return false;
+	if (index > 0)
+		out = static_cast<size_t>(index - 1);
+	else if (static_cast<size_t>(-index) <= defined)
+		out = defined - static_cast<size_t>(-index);
+	else
+		return false;
+	return out < total;
+}
+
+static size_t count_face_vertices(std::string_view line)
+{
+	size_t count = 0;
+	while (!next_token(line).empty()) ++count;
+	return count;
+}
+
+static lak::array<obj_chunk> split_obj_chunks(std::string_view text)
+{
+	const size_t chunk_count =
+	  parallel_range_count(text.size(), obj_min_chunk_size);
+
+	lak::array<obj_chunk> chunks;
+	chunks.reserve(chunk_count);
+	size_t begin = 0;
+	for (size_t i = 1; i <= chunk_count && begin < text.size(); ++i)
+	{
+		size_t end = (text.size() * i) / chunk_count;
+		if (i == chunk_count || end <= begin)
+			end = text.size();
+		else if (const size_t newline = text.find('\n', end);
+		         newline == std::string_view::npos)
+			end = text.size();
+		else
+			end = newline + 1;
+		chunks.push_back(obj_chunk{.text = text.substr(begin, end - begin)});
+		begin = end;
+	}
+	return chunks;
+}
+
+static bool count_obj_chunk(obj_chunk &chunk)
+{
+	return for_each_line(chunk.text,
+	                     [&](std::string_view line)
+	                     {
+		                     const auto keyword = next_token(line);
+		                     if (keyword == "v")
+			                     ++chunk.positions;
+		                     else if (keyword == "vt")
+			                     ++chunk.tex_coords;
+		                     else if (keyword == "vn")
+			                     ++chunk.normals;
+		                     else if (keyword == "f")
+		                     {
+			                     const size_t count = count_face_vertices(line);
+			                     if (count < 3) return false;
+			                     chunk.vertices += (count - 2) * 3;
+		                     }
+		                     return true;
+	                     });
+}
+
+static bool parse_obj_coords(const obj_chunk &chunk, obj_coords &coords)
+{
+	size_t position  = chunk.positions;
+	size_t tex_coord = chunk.tex_coords;
+	size_t normal    = chunk.normals;
+	return for_each_line(
+	  chunk.text,
+	  [&](std::string_view line)
+	  {
+		  const auto keyword = next_token(line);
+		  if (keyword == "v")
+		  {
+			  float v[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+			  if (!parse_floats(line, 3, v)) return false;
+			  coords.positions[position++] = glm::vec4{v[0], v[2], v[1], v[3]};
+		  }
+		  else if (keyword == "vt")
+		  {
+			  float vt[3] = {0.0f, 0.0f, 0.0f};
+			  if (!parse_floats(line, 1, vt)) return false;
+			  // lak::image is top-left origin, opengl is bottom-left
+			  coords.tex_coords[tex_coord++] = glm::vec2{vt[0], -vt[1]};
+		  }
+		  else if (keyword == "vn")
+		  {
+			  float vn[3] = {0.0f, 0.0f, 0.0f};
+			  if (!parse_floats(line, 3, vn)) return false;
+			  coords.normals[normal++] = glm::vec3{vn[0], vn[2], vn[1]};
+		  }
+		  return true;
+	  });
+}
+
+static bool parse_face_vertex(std::string_view token,
+                              const obj_coords &coords,
+                              size_t positions,
+                              size_t tex_coords,
+                              size_t normals,
+                              vertex &out)
+{
+	const size_t slash1 = token.find('/');
+	const size_t slash2 = slash1 == std::string_view::npos
+	                        ? std::string_view::npos
+	                        : token.find('/', slash1 + 1);
+
+	size_t index;
+	if (!resolve_index(token.substr(0, slash1),
+	                   positions,
+	                   coords.positions.size(),
+	                   index))
+		return false;
+	out.pos       = coords.positions[index];
+	out.col       = glm::vec4{1.0, 1.0, 1.0, 1.0};
+	out.tex_coord = glm::vec2{0.0};
+	out.norm      = glm::vec3{0.0};
+
+	if (slash1 == std::string_view::npos) return true;
+
+	auto vt = token.substr(slash1 + 1, slash2 - (slash1 + 1));
+	if (!vt.empty())
+	{
+		if (!resolve_index(vt, tex_coords, coords.tex_coords.size(), index))
+			return false;
+		out.tex_coord = coords.tex_coords[index];
+	}
+
+	if (slash2 == std::string_view::npos) return true;
+
+	auto vn = token.substr(slash2 + 1);
+	if (!vn.empty())
+	{
+		if (!resolve_index(vn, normals, coords.normals.size(), index))
+			return false;
+		out.norm = coords.normals[index];
+	}
+
+	return true;
+}
+
+static bool parse_obj_faces(const obj_chunk &chunk,
+                            const obj_coords &coords,
+                            vertex *out)
+{
+	// relative indices are relative to the elements defined so far in the
+	// whole file, so keep counting them as we go.
+	size_t positions  = chunk.positions;
+	size_t tex_coords = chunk.tex_coords;
+	size_t normals    = chunk.normals;
+	out += chunk.vertices;
+	return for_each_line(chunk.text,
+	                     [&](std::string_view line)
+	                     {
+		                     const auto keyword = next_token(line);
+		                     if (keyword == "v")
+			                     ++positions;
+		                     else if (keyword == "vt")
+			                     ++tex_coords;
+		                     else if (keyword == "vn")
+			                     ++normals;
+		                     else if (keyword == "f")
+		                     {
+			                     vertex first, prev;
+			                     for (size_t i = 0;; ++i)
+			                     {
+				                     auto token = next_token(line);
+				                     if (token.empty()) break;
+				                     vertex current;
+				                     if (!parse_face_vertex(token,
+				                                            coords,
+				                                            positions,
+				                                            tex_coords,
+				                                            normals,
+				                                            current))
+					                     return false;
+				                     if (i == 0)
+					                     first = current;
+				                     else if (i >= 2)
+				                     {
+					                     *(out++) = first;
+					                     *(out++) = prev;
+					                     *(out++) = current;
+				                     }
+				                     prev = current;
+			                     }
+		                     }
+		                     return true;
+	                     });
+}
+
+lak::optional<lak::array<vertex>> parse_obj_vertices(std::string_view text)
+{
+	auto chunks = split_obj_chunks(text);
+
+	std::atomic_bool failed = false;
+	auto run_chunks         = [&](auto &&func)
+	{
+		parallel_ranges(chunks.size(),
+		                chunks.size(),
+		                [&](size_t, size_t begin, size_t end)
+		                {
+			                for (size_t index = begin; index < end; index++)
+				                if (!func(chunks[index])) failed = true;
+		                });
+		return !failed;
+	};
+
+	// pass 1: count every element so the output can be sized exactly.
+	if (!run_chunks([](obj_chunk &chunk) { return count_obj_chunk(chunk); }))
+		return lak::nullopt;
+
+	obj_chunk total;
+	for (auto &chunk : chunks)
+	{
+		total.positions += std::exchange(chunk.positions, total.positions);
+		total.tex_coords += std::exchange(chunk.tex_coords, total.tex_coords);
+		total.normals += std::exchange(chunk.normals, total.normals);
+		total.vertices += std::exchange(chunk.vertices, total.vertices);
+	}
+
+	// pass 2: coordinates, faces may reference coordinates from any chunk.
+	obj_coords coords;
+	coords.positions.resize(total.positions);
+	coords.tex_coords.resize(total.tex_coords);
+	coords.normals.resize(total.normals);
+	if (!run_chunks([&](const obj_chunk &chunk)
+	                { return parse_obj_coords(chunk, coords); }))
+		return lak::nullopt;
+
+	// pass 3: faces, written straight into the final vertex buffer.
+	lak::array<vertex> result;
+	result.resize(total.vertices);
+	if (!run_chunks([&](const obj_chunk &chunk)
+	                { return parse_obj_faces(chunk, coords, result.data()); }))
+		return lak::nullopt;
+
+	return lak::optional<lak::array<vertex>>(std::move(result));
+}
+
+lak::array<vertex> load_model_file(const lak::fs::path &path)
+{
+	auto file = mapped_file::open(path);
+	ASSERTF(file, "failed to open ", path);
+	auto result = parse_obj_vertices(file->view());
+	ASSERTF(result, "failed to read obj ", path);
+	return std::move(*result);
+}
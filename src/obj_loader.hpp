@@ -0,0 +1,21 @@
+#ifndef OBJ_LOADER_HPP
+#define OBJ_LOADER_HPP
+
+#include "vertex.hpp"
+
+#include <lak/array.hpp>
+#include <lak/file.hpp>
+#include <lak/optional.hpp>
+
+#include <string_view>
+
+// Parses the text of a wavefront obj file directly into a triangle list.
+// Faces are fan triangulated. The text is split into line ranges that are
+// parsed in parallel, and the output is sized exactly by a counting pass
+// before any vertices are written.
+lak::optional<lak::array<vertex>> parse_obj_vertices(std::string_view text);
+
+// Memory maps the obj file at `path` and parses it with `parse_obj_vertices`.
+lak::array<vertex> load_model_file(const lak::fs::path &path);
+
+#endif
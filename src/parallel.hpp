@@ -0,0 +1,135 @@
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+#include <lak/array.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <type_traits>
+
+// Number of ranges to split `count` items into so that each range has at
+// least `min_per_range` items, capped at the hardware thread count.
+inline size_t parallel_range_count(size_t count, size_t min_per_range = 1)
+{
+	const size_t threads =
+	  std::max<size_t>(1U, std::thread::hardware_concurrency());
+	const size_t ranges = count / std::max<size_t>(1U, min_per_range);
+	return std::clamp<size_t>(ranges, 1U, threads);
+}
+
+// Splits [0, count) into `range_count` contiguous ranges and calls
+// `func(range_index, begin, end)` for each of them in parallel. The first
+// range runs on the calling thread. Returns once every range has completed.
+template<typename FUNC>
+void parallel_ranges(size_t count, size_t range_count, FUNC &&func)
+{
+	if (range_count <= 1)
+	{
+		func(size_t(0), size_t(0), count);
+		return;
+	}
+
+	lak::array<std::thread> threads;
+	threads.reserve(range_count - 1);
+	for (size_t i = 1; i < range_count; ++i)
+	{
+		threads.emplace_back(
+		  [&func, i, count, range_count]
+		  {
+			  func(i, (count * i) / range_count, (count * (i + 1)) / range_count);
+		  });
+	}
+
+	func(size_t(0), size_t(0), count / range_count);
+
+	for (auto &thread : threads) thread.join();
+}
+
+// A fixed set of worker threads for running parallel_ranges style jobs many
+// times without starting new threads for each one. Worker i runs range i + 1
+// of every job, the calling thread runs range 0.
+struct parallel_pool
+{
+	explicit parallel_pool(size_t range_count)
+	{
+		_threads.reserve(std::max<size_t>(range_count, 1U) - 1U);
+		for (size_t i = 1; i < range_count; ++i)
+			_threads.emplace_back([this, i] { worker(i); });
+	}
+
+	parallel_pool(const parallel_pool &)            = delete;
+	parallel_pool &operator=(const parallel_pool &) = delete;
+
+	~parallel_pool()
+	{
+		_quit.store(true, std::memory_order_relaxed);
+		_generation.fetch_add(1U, std::memory_order_release);
+		_generation.notify_all();
+		for (auto &thread : _threads) thread.join();
+	}
+
+	size_t range_count() const { return _threads.size() + 1U; }
+
+	// Same as parallel_ranges(count, range_count(), func).
+	template<typename FUNC>
+	void run(size_t count, FUNC &&func)
+	{
+		if (_threads.empty())
+		{
+			func(size_t(0), size_t(0), count);
+			return;
+		}
+
+		using func_t = std::remove_reference_t<FUNC>;
+		_job         = [](void *context, size_t range, size_t begin, size_t end)
+		{ (*static_cast<func_t *>(context))(range, begin, end); };
+		_context = const_cast<void *>(
+		  static_cast<const void *>(std::addressof(func)));
+		_count = count;
+		_remaining.store(uint32_t(_threads.size()), std::memory_order_relaxed);
+		_generation.fetch_add(1U, std::memory_order_release);
+		_generation.notify_all();
+
+		func(size_t(0), size_t(0), count / range_count());
+
+		uint32_t remaining;
+		while ((remaining = _remaining.load(std::memory_order_acquire)) != 0U)
+			_remaining.wait(remaining, std::memory_order_acquire);
+	}
+
+private:
+	void worker(size_t range)
+	{
+		uint32_t generation = 0U;
+		for (;;)
+		{
+			_generation.wait(generation, std::memory_order_acquire);
+			if (_quit.load(std::memory_order_relaxed)) return;
+			++generation;
+
+			const size_t ranges = range_count();
+			_job(_context,
+			     range,
+			     (_count * range) / ranges,
+			     (_count * (range + 1)) / ranges);
+
+			if (_remaining.fetch_sub(1U, std::memory_order_acq_rel) == 1U)
+				_remaining.notify_one();
+		}
+	}
+
+	lak::array<std::thread> _threads;
+	// the current job, only written while every worker is idle.
+	void (*_job)(void *, size_t, size_t, size_t) = nullptr;
+	void *_context                                = nullptr;
+	size_t _count                                 = 0U;
+	std::atomic_bool _quit                        = false;
+	std::atomic<uint32_t> _generation             = 0U;
+	std::atomic<uint32_t> _remaining              = 0U;
+};
+
+#endif
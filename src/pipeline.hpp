@@ -0,0 +1,118 @@
+#ifndef PIPELINE_HPP
+#define PIPELINE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <utility>
+
+// Double buffered simulation/render pipeline.
+//
+// Tick N+1 is stepped on a worker thread into one snapshot buffer while the
+// render thread reads tick N from the other. The handoff is two atomic tick
+// counters, neither the buffers nor the simulation state are locked.
+//
+// Once per frame the render thread calls:
+//   wait()  - blocks until the in flight tick has finished, after this the
+//             simulation state can be touched freely until the next kick().
+//   kick()  - starts the next tick.
+//   front() - the previous tick's snapshot, valid until the next wait().
+template<typename SNAPSHOT>
+struct sim_pipeline
+{
+	using step_func = std::function<void(SNAPSHOT &)>;
+
+	~sim_pipeline() { stop(); }
+
+	bool running() const { return _thread.joinable(); }
+
+	void start(step_func step)
+	{
+		stop();
+		_step = std::move(step);
+		_quit = false;
+		_requested.store(0U, std::memory_order_relaxed);
+		_completed.store(0U, std::memory_order_relaxed);
+		_thread = std::thread([this] { worker(); });
+	}
+
+	void stop()
+	{
+		if (!running()) return;
+		wait();
+		_quit.store(true, std::memory_order_relaxed);
+		_requested.fetch_add(1U, std::memory_order_release);
+		_requested.notify_one();
+		_thread.join();
+	}
+
+	void wait()
+	{
+		const auto start         = clock::now();
+		const uint64_t requested = _requested.load(std::memory_order_relaxed);
+		uint64_t completed;
+		while ((completed = _completed.load(std::memory_order_acquire)) !=
+		       requested)
+			_completed.wait(completed, std::memory_order_acquire);
+		_wait_seconds = seconds_since(start);
+	}
+
+	void kick()
+	{
+		_requested.fetch_add(1U, std::memory_order_release);
+		_requested.notify_one();
+	}
+
+	const SNAPSHOT &front() const
+	{
+		return _buffers[(_requested.load(std::memory_order_relaxed) - 1U) & 1U];
+	}
+
+	// Duration of the last tick on the worker thread.
+	double sim_seconds() const
+	{
+		return _sim_seconds.load(std::memory_order_relaxed);
+	}
+
+	// How long the last wait() blocked the render thread for.
+	double wait_seconds() const { return _wait_seconds; }
+
+private:
+	using clock = std::chrono::steady_clock;
+
+	static double seconds_since(clock::time_point start)
+	{
+		return std::chrono::duration<double>(clock::now() - start).count();
+	}
+
+	void worker()
+	{
+		uint64_t tick = _completed.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			_requested.wait(tick, std::memory_order_acquire);
+			if (_quit.load(std::memory_order_relaxed)) return;
+
+			++tick;
+			const auto start = clock::now();
+			_step(_buffers[tick & 1U]);
+			_sim_seconds.store(seconds_since(start), std::memory_order_relaxed);
+
+			_completed.store(tick, std::memory_order_release);
+			_completed.notify_one();
+		}
+	}
+
+	step_func _step;
+	SNAPSHOT _buffers[2];
+	std::thread _thread;
+	std::atomic_bool _quit           = false;
+	std::atomic<uint64_t> _requested = 0U;
+	std::atomic<uint64_t> _completed = 0U;
+	std::atomic<double> _sim_seconds = 0.0;
+	double _wait_seconds             = 0.0;
+};
+
+#endif
@@ -6,7 +6,9 @@
 
 #include <glm/ext/matrix_transform.hpp>
 
-#include <numbers>
+#include <array>
+#include <cmath>
+#include <utility>
 
 reference_frame::~reference_frame()
 {
@@ -36,10 +38,9 @@ void reference_frame::update(float delta)
 {
 	rotation.velocity += rotation.acceleration * delta;
 	rotation.value += rotation.velocity * delta;
-	constexpr float tau = 2.f * std::numbers::pi_v<float>;
-	rotation.value.x    = lak::fslack(-rotation.value.x, tau);
-	rotation.value.y    = lak::fslack(-rotation.value.y, tau);
-	rotation.value.z    = lak::fslack(-rotation.value.z, tau);
+	rotation.value.x = wrap_angle(rotation.value.x);
+	rotation.value.y = wrap_angle(rotation.value.y);
+	rotation.value.z = wrap_angle(rotation.value.z);
 
 	translation.velocity += translation.acceleration * delta;
 	translation.value += translation.velocity * delta;
@@ -53,9 +54,75 @@ glm::mat4 reference_frame::get_parent() const
 	return parent ? parent->get_transform() : glm::mat4(1.0f);
 }
 
+// T * Rz * Ry * Rx * S built straight from sin/cos. Components that are
+// compiled out fold to identity, so a translation only frame is just a copy
+// of the translation into the last column.
+template<bool ROT_X, bool ROT_Y, bool ROT_Z, bool SCALE>
+static glm::mat4 local_transform(const reference_frame &frame)
+{
+	const glm::vec3 &angle = frame.rotation.value;
+	const float sx         = ROT_X ? std::sin(angle.x) : 0.0f;
+	const float cx         = ROT_X ? std::cos(angle.x) : 1.0f;
+	const float sy         = ROT_Y ? std::sin(angle.y) : 0.0f;
+	const float cy         = ROT_Y ? std::cos(angle.y) : 1.0f;
+	const float sz         = ROT_Z ? std::sin(angle.z) : 0.0f;
+	const float cz         = ROT_Z ? std::cos(angle.z) : 1.0f;
+
+	glm::mat4 result(1.0f);
+
+	if constexpr (ROT_X || ROT_Y || ROT_Z)
+	{
+		result[0] = glm::vec4(cz * cy, sz * cy, -sy, 0.0f);
+		result[1] = glm::vec4(
+		  cz * sy * sx - sz * cx, sz * sy * sx + cz * cx, cy * sx, 0.0f);
+		result[2] = glm::vec4(
+		  cz * sy * cx + sz * sx, sz * sy * cx - cz * sx, cy * cx, 0.0f);
+	}
+
+	if constexpr (SCALE)
+	{
+		result[0] *= frame.scale.value.x;
+		result[1] *= frame.scale.value.y;
+		result[2] *= frame.scale.value.z;
+	}
+
+	result[3] = glm::vec4(frame.translation.value, 1.0f);
+	return result;
+}
+
+using local_transform_kernel = glm::mat4 (*)(const reference_frame &);
+
+// Indexed by rot x | rot y << 1 | rot z << 2 | scale << 3.
+template<size_t... I>
+static constexpr auto make_local_transform_kernels(std::index_sequence<I...>)
+{
+	return std::array<local_transform_kernel, sizeof...(I)>{
+	  &local_transform<bool(I & 1), bool(I & 2), bool(I & 4), bool(I & 8)>...};
+}
+
+static constexpr auto local_transform_kernels =
+  make_local_transform_kernels(std::make_index_sequence<16>{});
+
+glm::mat4 reference_frame::get_local_transform() const
+{
+	const size_t kernel = (rotation.value.x != 0.0f ? 1U : 0U) |
+	                      (rotation.value.y != 0.0f ? 2U : 0U) |
+	                      (rotation.value.z != 0.0f ? 4U : 0U) |
+	                      (scale.value != glm::vec3(1.0f) ? 8U : 0U);
+	return local_transform_kernels[kernel](*this);
+}
+
 glm::mat4 reference_frame::get_transform() const
 {
-	auto trans = glm::translate(get_parent(), translation.value);
+	if (parent) return parent->get_transform() * get_local_transform();
+	return get_local_transform();
+}
+
+glm::mat4 reference_frame::get_transform_reference() const
+{
+	auto trans = glm::translate(
+	  parent ? parent->get_transform_reference() : glm::mat4(1.0f),
+	  translation.value);
 	trans      = glm::rotate(trans, rotation.value.z, glm::vec3(0, 0, 1));
 	trans      = glm::rotate(trans, rotation.value.y, glm::vec3(0, 1, 0));
 	trans      = glm::rotate(trans, rotation.value.x, glm::vec3(1, 0, 0));
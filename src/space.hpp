@@ -2,11 +2,22 @@
 #define SPACE_HPP
 
 #include <lak/array.hpp>
+#include <lak/math.hpp>
 #include <lak/memory.hpp>
 
 #include <glm/mat4x4.hpp>
 #include <glm/vec3.hpp>
 
+#include <numbers>
+
+// Wraps an angle in radians the same way reference_frame::update does. Inline
+// so loops over many angles can be vectorised.
+inline float wrap_angle(float angle)
+{
+	constexpr float tau = 2.f * std::numbers::pi_v<float>;
+	return lak::fslack(-angle, tau);
+}
+
 struct delta_transform
 {
 	glm::vec3 value        = glm::vec3(0.0);
@@ -33,7 +44,14 @@ struct reference_frame
 	void update(float delta);
 
 	glm::mat4 get_parent() const;
+	// picks a kernel specialised for which of rotation x/y/z and scale are
+	// non-identity.
 	glm::mat4 get_transform() const;
+	// the general translate/rotate/rotate/rotate/scale path that
+	// get_transform must match.
+	glm::mat4 get_transform_reference() const;
+	// only the transform relative to the parent.
+	glm::mat4 get_local_transform() const;
 
 	glm::vec3 total_translation() const;
 
@@ -0,0 +1,44 @@
+#ifndef TILE_GRID_HPP
+#define TILE_GRID_HPP
+
+#include <lak/array.hpp>
+
+#include <glm/vec2.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+enum tile_flag : uint8_t
+{
+	TILE_BLOCK = 1U << 0,
+	TILE_COIN  = 1U << 1,
+	TILE_LIGHT = 1U << 2,
+};
+
+// Row major grid of tile_flag bits, one entry per map texel.
+struct tile_grid
+{
+	size_t width  = 0;
+	size_t height = 0;
+	lak::array<uint8_t> tiles;
+
+	uint8_t at(size_t x, size_t y) const { return tiles[x + (y * width)]; }
+
+	bool has(size_t x, size_t y, tile_flag flag) const
+	{
+		return (at(x, y) & flag) != 0;
+	}
+};
+
+// World space height of each kind of tile entity.
+constexpr float block_z = -2.0f;
+constexpr float coin_z  = 0.0f;
+constexpr float light_z = 2.0f;
+
+// World space position of the centre of tile (x, y).
+inline glm::vec2 tile_position(size_t x, size_t y)
+{
+	return glm::vec2{x * 2.0f, y * -2.0f};
+}
+
+#endif
@@ -0,0 +1,34 @@
+#include "uniform_buffer.hpp"
+
+void bind_uniform_blocks()
+{
+	GLint program = 0;
+	lak::opengl::call_checked(glGetIntegerv, GL_CURRENT_PROGRAM, &program)
+	  .UNWRAP();
+	ASSERT(program != 0);
+
+	const GLuint frame_index =
+	  glGetUniformBlockIndex(GLuint(program), "FrameData");
+	ASSERT(frame_index != GL_INVALID_INDEX);
+	lak::opengl::call_checked(
+	  glUniformBlockBinding, GLuint(program), frame_index, frame_uniforms_binding)
+	  .UNWRAP();
+
+	const GLuint object_index =
+	  glGetUniformBlockIndex(GLuint(program), "ObjectData");
+	ASSERT(object_index != GL_INVALID_INDEX);
+	lak::opengl::call_checked(glUniformBlockBinding,
+	                          GLuint(program),
+	                          object_index,
+	                          object_uniforms_binding)
+	  .UNWRAP();
+}
+
+GLsizeiptr uniform_buffer_offset_alignment()
+{
+	GLint alignment = 0;
+	lak::opengl::call_checked(
+	  glGetIntegerv, GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment)
+	  .UNWRAP();
+	return alignment > 0 ? GLsizeiptr(alignment) : GLsizeiptr(256);
+}
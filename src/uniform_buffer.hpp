@@ -0,0 +1,237 @@
+#ifndef UNIFORM_BUFFER_HPP
+#define UNIFORM_BUFFER_HPP
+
+#include <lak/array.hpp>
+#include <lak/debug.hpp>
+#include <lak/opengl/mesh.hpp>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Must match MAX_LIGHTS in the shaders.
+constexpr size_t max_lights = 6;
+
+constexpr GLuint frame_uniforms_binding  = 0;
+constexpr GLuint object_uniforms_binding = 1;
+
+// std140 layout of the shaders' light struct, position.w is padding.
+struct std140_light
+{
+	glm::vec4 position;
+	glm::vec4 colour;
+};
+
+// std140 layout of the FrameData uniform block.
+struct frame_uniforms
+{
+	glm::mat4 projview;
+	glm::mat4 invprojview;
+	glm::vec4 ambient;
+	glm::vec4 diffuse;
+	glm::vec4 specular;
+	float shininess;
+	int32_t light_count;
+	int32_t _pad[2];
+	std140_light lights[max_lights];
+};
+static_assert(offsetof(frame_uniforms, ambient) == 128);
+static_assert(offsetof(frame_uniforms, shininess) == 176);
+static_assert(offsetof(frame_uniforms, lights) == 192);
+
+// std140 layout of the ObjectData uniform block.
+struct object_uniforms
+{
+	glm::mat4 model;
+	int32_t baked_lighting;
+	int32_t _pad[3];
+};
+static_assert(sizeof(object_uniforms) == 80);
+
+// Binds the FrameData and ObjectData blocks of the currently used program to
+// frame_uniforms_binding and object_uniforms_binding.
+void bind_uniform_blocks();
+
+GLsizeiptr uniform_buffer_offset_alignment();
+
+// A uniform buffer holding a single T, which is only re-uploaded when its
+// contents change.
+template<typename T>
+struct uniform_block
+{
+	uniform_block()
+	{
+		lak::opengl::call_checked(glGenBuffers, 1, &_buffer).UNWRAP();
+		lak::opengl::call_checked(glBindBuffer, GL_UNIFORM_BUFFER, _buffer)
+		  .UNWRAP();
+		lak::opengl::call_checked(glBufferData,
+		                          GL_UNIFORM_BUFFER,
+		                          GLsizeiptr(sizeof(T)),
+		                          nullptr,
+		                          GL_DYNAMIC_DRAW)
+		  .UNWRAP();
+	}
+
+	~uniform_block() { glDeleteBuffers(1, &_buffer); }
+
+	uniform_block(const uniform_block &)            = delete;
+	uniform_block &operator=(const uniform_block &) = delete;
+
+	// Returns true if `data` was different and had to be uploaded.
+	bool update(const T &data)
+	{
+		if (_uploaded && std::memcmp(&_data, &data, sizeof(T)) == 0) return false;
+		_data     = data;
+		_uploaded = true;
+		lak::opengl::call_checked(glBindBuffer, GL_UNIFORM_BUFFER, _buffer)
+		  .UNWRAP();
+		lak::opengl::call_checked(
+		  glBufferSubData, GL_UNIFORM_BUFFER, 0, GLsizeiptr(sizeof(T)), &_data)
+		  .UNWRAP();
+		++_uploads;
+		return true;
+	}
+
+	void bind(GLuint binding) const
+	{
+		lak::opengl::call_checked(
+		  glBindBufferBase, GL_UNIFORM_BUFFER, binding, _buffer)
+		  .UNWRAP();
+	}
+
+	uint64_t uploads() const { return _uploads; }
+
+private:
+	GLuint _buffer = 0;
+	T _data;
+	bool _uploaded    = false;
+	uint64_t _uploads = 0;
+};
+
+// A uniform buffer split into `sections` regions of up to `capacity` Ts
+// each, written by the CPU one section per frame while the GPU is still
+// reading the previous frames' sections. Each section is fenced when the
+// frame ends, and only waited on when the ring wraps back around to it.
+template<typename T>
+struct uniform_ring_buffer
+{
+	uniform_ring_buffer(size_t capacity, size_t sections = 3)
+	: _capacity(capacity), _sections(sections)
+	{
+		const auto align = size_t(uniform_buffer_offset_alignment());
+		_stride          = ((sizeof(T) + align - 1) / align) * align;
+		_section_size    = ((_stride * _capacity + align - 1) / align) * align;
+		_fences.resize(_sections);
+		for (auto &fence : _fences) fence = nullptr;
+
+		lak::opengl::call_checked(glGenBuffers, 1, &_buffer).UNWRAP();
+		lak::opengl::call_checked(glBindBuffer, GL_UNIFORM_BUFFER, _buffer)
+		  .UNWRAP();
+		lak::opengl::call_checked(glBufferData,
+		                          GL_UNIFORM_BUFFER,
+		                          GLsizeiptr(_section_size * _sections),
+		                          nullptr,
+		                          GL_STREAM_DRAW)
+		  .UNWRAP();
+	}
+
+	~uniform_ring_buffer()
+	{
+		for (auto &fence : _fences)
+			if (fence) glDeleteSync(fence);
+		glDeleteBuffers(1, &_buffer);
+	}
+
+	uniform_ring_buffer(const uniform_ring_buffer &)            = delete;
+	uniform_ring_buffer &operator=(const uniform_ring_buffer &) = delete;
+
+	size_t capacity() const { return _capacity; }
+
+	// Number of times map() had to wait for the GPU.
+	uint64_t stalls() const { return _stalls; }
+
+	// Maps the first `count` entries of this frame's section for writing.
+	void map(size_t count)
+	{
+		ASSERT(count <= _capacity);
+		if (GLsync &fence = _fences[_section]; fence)
+		{
+			GLenum result = glClientWaitSync(fence, 0, 0);
+			if (result == GL_TIMEOUT_EXPIRED)
+			{
+				++_stalls;
+				do
+				{
+					result = glClientWaitSync(
+					  fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000U);
+				} while (result == GL_TIMEOUT_EXPIRED);
+			}
+			glDeleteSync(fence);
+			fence = nullptr;
+		}
+
+		if (count == 0) return;
+
+		lak::opengl::call_checked(glBindBuffer, GL_UNIFORM_BUFFER, _buffer)
+		  .UNWRAP();
+		// the fence guarantees the GPU is done with this section, so skip the
+		// driver's own synchronisation.
+		_mapped = static_cast<uint8_t *>(
+		  glMapBufferRange(GL_UNIFORM_BUFFER,
+		                   GLintptr(_section * _section_size),
+		                   GLsizeiptr(count * _stride),
+		                   GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT |
+		                     GL_MAP_UNSYNCHRONIZED_BIT));
+		ASSERT(_mapped);
+	}
+
+	T &operator[](size_t index)
+	{
+		return *reinterpret_cast<T *>(_mapped + (index * _stride));
+	}
+
+	void unmap()
+	{
+		if (!_mapped) return;
+		lak::opengl::call_checked(glBindBuffer, GL_UNIFORM_BUFFER, _buffer)
+		  .UNWRAP();
+		glUnmapBuffer(GL_UNIFORM_BUFFER);
+		_mapped = nullptr;
+	}
+
+	// Binds entry `index` of this frame's section to `binding`.
+	void bind(GLuint binding, size_t index) const
+	{
+		lak::opengl::call_checked(
+		  glBindBufferRange,
+		  GL_UNIFORM_BUFFER,
+		  binding,
+		  _buffer,
+		  GLintptr((_section * _section_size) + (index * _stride)),
+		  GLsizeiptr(sizeof(T)))
+		  .UNWRAP();
+	}
+
+	// Fences this frame's section after every draw that reads it.
+	void end_frame()
+	{
+		_fences[_section] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		_section          = (_section + 1) % _sections;
+	}
+
+private:
+	GLuint _buffer       = 0;
+	size_t _capacity     = 0;
+	size_t _sections     = 0;
+	size_t _stride       = 0;
+	size_t _section_size = 0;
+	size_t _section      = 0;
+	lak::array<GLsync> _fences;
+	uint8_t *_mapped = nullptr;
+	uint64_t _stalls = 0;
+};
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef VERTEX_HPP
+#define VERTEX_HPP
+
+#include <lak/array.hpp>
+
+#include <lak/opengl/mesh.hpp>
+#include <lak/opengl/shader.hpp>
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include <cstddef>
+
+struct vertex
+{
+	glm::vec4 pos;
+	glm::vec4 col;
+	glm::vec3 norm;
+	glm::vec2 tex_coord;
+
+	static lak::array<lak::opengl::vertex_attribute> attributes()
+	{
+		return lak::array<lak::opengl::vertex_attribute>{
+		  {
+		    .size       = 4,
+		    .type       = GL_FLOAT,
+		    .normalised = GL_FALSE,
+		    .stride     = sizeof(vertex),
+		    .offset     = offsetof(vertex, pos),
+		    .divisor    = 0,
+		  },
+		  {
+		    .size       = 4,
+		    .type       = GL_FLOAT,
+		    .normalised = GL_FALSE,
+		    .stride     = sizeof(vertex),
+		    .offset     = offsetof(vertex, col),
+		    .divisor    = 0,
+		  },
+		  {
+		    .size       = 3,
+		    .type       = GL_FLOAT,
+		    .normalised = GL_FALSE,
+		    .stride     = sizeof(vertex),
+		    .offset     = offsetof(vertex, norm),
+		    .divisor    = 0,
+		  },
+		  {
+		    .size       = 2,
+		    .type       = GL_FLOAT,
+		    .normalised = GL_FALSE,
+		    .stride     = sizeof(vertex),
+		    .offset     = offsetof(vertex, tex_coord),
+		    .divisor    = 0,
+		  }};
+	}
+
+	static lak::array<GLuint, 4U> attribute_indices(
+	  const lak::opengl::program &shader,
+	  const GLchar *pos_name,
+	  const GLchar *col_name,
+	  const GLchar *norm_name,
+	  const GLchar *tex_coord_name)
+	{
+		return lak::array<GLuint, 4U>{
+		  shader.assert_attrib_index(pos_name),
+		  shader.assert_attrib_index(col_name),
+		  shader.assert_attrib_index(norm_name),
+		  shader.assert_attrib_index(tex_coord_name),
+		};
+	}
+};
+
+#endif